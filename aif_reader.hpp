@@ -0,0 +1,284 @@
+#ifndef AIF_READER_HPP
+#define AIF_READER_HPP
+
+#include "scheduler.hpp"
+#include <string_view>
+#include <charconv>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Reader for the .aif netlist format:
+//
+//	inputs  (name width)*
+//	outputs (name width)*
+//	regs    (name width)*
+//	(opN type width operand1 operand2 output)*
+//	end
+//
+//The file is mapped read-only and cut into string_view tokens that point
+//into the mapping; a name is copied only the first time it is interned,
+//and repeated names are looked up without building a string.
+//Any deviation from the grammar is reported as file:line:column and
+//nothing after the first error is trusted.
+
+struct mappedFile {
+	const char* data;
+	size_t size;
+#if defined(_WIN32)
+	vector<char> buffer;
+#endif
+};
+
+bool mapFile(const string& path, mappedFile& file)
+{
+	file.data = NULL;
+	file.size = 0;
+#if defined(_WIN32)
+	ifstream in(path.c_str(), ios::binary);
+	if (!in)
+		return false;
+	file.buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	file.data = file.buffer.data();
+	file.size = file.buffer.size();
+	return true;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	struct stat st;
+
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		close(fd);
+		return false;
+	}
+
+	if (st.st_size > 0)
+	{
+		void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+		madvise(p, st.st_size, MADV_SEQUENTIAL);
+		file.data = (const char*)p;
+		file.size = st.st_size;
+	}
+	close(fd); //the mapping stays valid
+	return true;
+#endif
+}
+
+void unmapFile(mappedFile& file)
+{
+#if defined(_WIN32)
+	file.buffer.clear();
+#else
+	if (file.data != NULL)
+		munmap((void*)file.data, file.size);
+#endif
+	file.data = NULL;
+	file.size = 0;
+}
+
+struct aifToken {
+	string_view text; //empty at end of file
+	int line, column;
+};
+
+struct aifLexer {
+	const char* p;
+	const char* end;
+	const char* lineStart;
+	int line;
+
+	void init(const char* data, size_t size)
+	{
+		p = lineStart = data;
+		end = data + size;
+		line = 1;
+	}
+
+	aifToken next()
+	{
+		aifToken t;
+
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+		{
+			if (*p == '\n')
+			{
+				line++;
+				lineStart = p + 1;
+			}
+			p++;
+		}
+
+		const char* start = p;
+		while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			p++;
+
+		t.text = string_view(start, p - start);
+		t.line = line;
+		t.column = start - lineStart + 1;
+		return t;
+	}
+};
+
+struct aifParser {
+	synthesisContext& ctx; //design the file is read into
+	aifLexer lex;
+	string fileName;
+
+	aifParser(synthesisContext& context) : ctx(context) {}
+
+	bool error(const aifToken& t, const string& expected)
+	{
+		*ctx.report << fileName << ":" << t.line << ":" << t.column << ": expected " << expected;
+		if (t.text.empty())
+			*ctx.report << ", found end of file" << endl;
+		else
+			*ctx.report << ", found '" << t.text << "'" << endl;
+		return false;
+	}
+
+	bool width(int& bits)
+	{
+		aifToken t = lex.next();
+		const char* last = t.text.data() + t.text.size();
+		from_chars_result r = from_chars(t.text.data(), last, bits);
+
+		if (t.text.empty() || r.ec != errc() || r.ptr != last || bits < 1)
+			return error(t, "a positive bit width");
+		return true;
+	}
+
+	static bool isOpLabel(string_view text)
+	{
+		if (text.size() < 3 || text.substr(0, 2) != "op")
+			return false;
+		for (size_t k = 2; k < text.size(); k++)
+			if (text[k] < '0' || text[k] > '9')
+				return false;
+		return true;
+	}
+
+	static bool isKeyword(string_view text)
+	{
+		return text == "inputs" || text == "outputs" || text == "regs" || text == "end";
+	}
+
+	//name width pairs up to the keyword that opens the next section; the
+	//register section (nextSection empty) ends at the first operation or 'end'
+	bool declarations(vector<int>* ids, string_view nextSection, aifToken& t, int& groupBits)
+	{
+		for (t = lex.next(); ; t = lex.next())
+		{
+			if (nextSection.empty() ? (isOpLabel(t.text) || t.text == "end") : t.text == nextSection)
+				break;
+			if (t.text.empty() || isKeyword(t.text) || isOpLabel(t.text))
+				return error(t, nextSection.empty() ? string("a register name, an operation or 'end'")
+					: "a signal name or '" + string(nextSection) + "'");
+
+			int id = internSymbol(ctx, t.text);
+			if (ctx.symbols[id].width != 0)
+			{
+				*ctx.report << fileName << ":" << t.line << ":" << t.column << ": signal '" << t.text
+					<< "' is declared twice" << endl;
+				return false;
+			}
+			if (!width(ctx.symbols[id].width))
+				return false;
+
+			groupBits = max(groupBits, ctx.symbols[id].width);
+			if (ids != NULL)
+				ids->push_back(id);
+			else
+			{
+				ctx.registers.push_back(reg());
+				ctx.registers.back().symbolId = id;
+				ctx.registers.back().first = 0;
+				ctx.registers.back().last = 0;
+			}
+		}
+		return true;
+	}
+
+	bool operand(int& id)
+	{
+		aifToken t = lex.next();
+		if (t.text.empty() || isKeyword(t.text) || isOpLabel(t.text))
+			return error(t, "a signal name");
+		id = internSymbol(ctx, t.text);
+		return true;
+	}
+
+	bool parse(const char* data, size_t size)
+	{
+		aifToken t;
+
+		lex.init(data, size);
+		t = lex.next();
+		if (t.text != "inputs")
+			return error(t, "'inputs'");
+
+		if (!declarations(&ctx.inputs, "outputs", t, ctx.inputBits) ||
+			!declarations(&ctx.outputs, "regs", t, ctx.outputBits) ||
+			!declarations(NULL, "", t, ctx.registerBits))
+			return false;
+
+		while (t.text != "end")
+		{
+			if (!isOpLabel(t.text))
+				return error(t, "an operation label (opN) or 'end'");
+
+			operation op;
+			aifToken type = lex.next();
+			if (type.text.empty() || isKeyword(type.text) || isOpLabel(type.text))
+				return error(type, "an operation type");
+			op.type = string(type.text);
+			op.typeId = internOpType(ctx, type.text);
+			op.timestep = 0;
+
+			if (!width(op.width) || !operand(op.operand1) || !operand(op.operand2) || !operand(op.output))
+				return false;
+			ctx.operationBits = max(ctx.operationBits, op.width);
+			ctx.operations.push_back(op);
+			t = lex.next();
+		}
+
+		t = lex.next();
+		if (!t.text.empty())
+			return error(t, "end of file after 'end'");
+		return true;
+	}
+};
+
+//Parse path into ctx's design tables; false (after printing why) on any error.
+bool readAIF(synthesisContext& ctx, const string& path)
+{
+	mappedFile file;
+	aifParser parser(ctx);
+	bool ok;
+
+	if (!mapFile(path, file))
+	{
+		*ctx.report << "Could not open file " + path + " for reading" << endl;
+		return false;
+	}
+
+	parser.fileName = path;
+	ok = parser.parse(file.data, file.size);
+	unmapFile(file);
+
+	if (ok)
+		buildDefUse(ctx);
+	return ok;
+}
+
+#endif
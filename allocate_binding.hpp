@@ -1,46 +1,82 @@
+#ifndef ALLOCATE_BINDING_HPP
+#define ALLOCATE_BINDING_HPP
+
 #include "scheduler.hpp"
+#include "compat_builder.hpp"
 #include <algorithm>
 
-void allocateFunctionalUnits()
-{
-	int n = operations.size(); //length of a side of this square matrix
-	funcCompGraph = new int*[n];
+enum fuBinder { FU_BIND_CLIQUE, FU_BIND_STEP };
+fuBinder functionalUnitBinder = FU_BIND_CLIQUE; //how allocateFunctionalUnits() groups operations
+clique_search cliqueSearch = { 1, 1, 0, CLIQUE_FEWEST }; //partitions each clique binder tries (budget per binder); one is the plain heuristic
 
-	for (int i = 0; i < n; i++) //declare empty comp graph filled with junk data
-		funcCompGraph[i] = new int[n];
+void bindFunctionalUnitsByClique(synthesisContext& ctx) //Tseng-Siewiorek clique partitioning of the comp graph
+{
+	int n = ctx.operations.size(); //length of a side of this square matrix
+	compat_matrix_init(&ctx.funcCompGraph, n, &ctx.synthArena); //bit-packed comp graph, all edges cleared
 
+	//compatible: same type and a different timestep (and every op with itself)
+	sameTypeOtherStepKernel kernel(n);
 	for (int i = 0; i < n; i++)
-		for (int j = 0; j < n; j++)
-			//check each op against all other ops. If op = op, or 
-			//if they are same type, different ops, and different timestep
-			if ((i == j) ||
-				((operations[i].type == operations[j].type) &&
-				(operations[i].timestep != operations[j].timestep)))
-			{
-				funcCompGraph[i][j] = 1;
-				funcCompGraph[j][i] = 1;
-			}
-			else {
-				funcCompGraph[i][j] = 0;
-				funcCompGraph[j][i] = 0;
-			}
-
-			clique_partition(funcCompGraph, n); //access results in clique_set[]
-
-			int opIndex;
-
-			for (int i = 0; i < MAXCLIQUES; i++)
-			{
-				if (clique_set[i].size == UNKNOWN) break;
-				opResources.push_back(resource());
-
-				opIndex = clique_set[i].members[0];
-				opResources[i].type = operations[opIndex].type;
-
-				for (int j = 0; j < MAXCLIQUES; j++)
-					if (clique_set[i].members[j] != UNKNOWN)
-						opResources[i].clique.push_back(clique_set[i].members[j]);
-					else
-						break;
-			}
+	{
+		kernel.type[i] = ctx.operations[i].typeId;
+		kernel.step[i] = ctx.operations[i].timestep;
+	}
+	buildSymmetricMatrix(&ctx.funcCompGraph, kernel, ctx.pool);
+
+	clique_result cliques;
+	clique_partition(&ctx.funcCompGraph, &cliques, ctx.pool, &cliqueSearch); //access results in cliques
+
+	int opIndex;
+
+	for (int i = 0; i < cliques.num_cliques; i++)
+	{
+		ctx.opResources.push_back(resource());
+
+		opIndex = clique_members(&cliques, i)[0];
+		ctx.opResources[i].type = ctx.operations[opIndex].type;
+		ctx.opResources[i].clique.assign(clique_members(&cliques, i),
+			clique_members(&cliques, i) + clique_size(&cliques, i));
+	}
+	ctx.fuPartition = cliques.stats;
+	clique_result_free(&cliques);
+}
+
+//Two ops are compatible exactly when they have the same type and different
+//timesteps, so every type needs as many units as its busiest timestep and the
+//k-th op of a type in any timestep can simply go to unit k of that type.
+//One pass over the ops, no comp graph.
+void bindFunctionalUnitsByStep(synthesisContext& ctx)
+{
+	int maxTimestep = 0;
+	vector<vector<int> > units(ctx.opTypes.size()); //units[type][k] = opResources index of unit k
+
+	for (int i = 0; i < ctx.operations.size(); i++)
+		if (ctx.operations[i].timestep > maxTimestep)
+			maxTimestep = ctx.operations[i].timestep;
+
+	vector<int> slotsUsed(ctx.opTypes.size() * (maxTimestep + 1), 0); //ops placed so far per (type, timestep)
+
+	for (int i = 0; i < ctx.operations.size(); i++)
+	{
+		int type = ctx.operations[i].typeId;
+		int slot = slotsUsed[type * (maxTimestep + 1) + ctx.operations[i].timestep]++;
+
+		if (slot == units[type].size()) //busiest timestep so far, needs another unit
+		{
+			units[type].push_back(ctx.opResources.size());
+			ctx.opResources.push_back(resource());
+			ctx.opResources.back().type = ctx.operations[i].type;
+		}
+		ctx.opResources[units[type][slot]].clique.push_back(i);
+	}
 }
+
+void allocateFunctionalUnits(synthesisContext& ctx)
+{
+	if (functionalUnitBinder == FU_BIND_STEP)
+		bindFunctionalUnitsByStep(ctx);
+	else
+		bindFunctionalUnitsByClique(ctx);
+}
+
+#endif
@@ -1,80 +1,188 @@
+#ifndef ALLOCATE_REG_HPP
+#define ALLOCATE_REG_HPP
+
 #include "allocate_binding.hpp"
 #include <algorithm>
+#include <queue>
+#include <functional>
+
+enum regBinder { REG_BIND_CLIQUE, REG_BIND_LEFT_EDGE };
+regBinder registerBinder = REG_BIND_CLIQUE; //how allocateRegisters() groups registers
 
-void allocateRegisters() //need to make it work for register
+void computeRegisterLifetimes(synthesisContext& ctx)
 {
-	int m = operations.size();//# of operations
-	int n; //length of a side of the compatibility matrix
 	int maxTimestep = 0;
 
-	for (int i = 0; i < inputs.size(); i++)
+	for (int j = 0; j < ctx.operations.size(); j++)
+		if (ctx.operations[j].timestep > maxTimestep)
+			maxTimestep = ctx.operations[j].timestep;
+
+	for (int i = 0; i < ctx.inputs.size(); i++) //inputs are live from the start
 	{
-		registers.push_back(reg());
-		registers.back().name = inputs[i];
-		registers.back().first = 0;
+		ctx.registers.push_back(reg());
+		ctx.registers.back().symbolId = ctx.inputs[i];
+		ctx.registers.back().first = 0;
+	}
 
-		for (int j = 0; j < m; j++) //if operation has this input has an operand, inputs first/last are operation's timestep
-			if (operations[j].operand1 == inputs[i] || operations[j].operand2 == inputs[i])
-				registers.back().last = operations[j].timestep;
+	for (int i = 0; i < ctx.outputs.size(); i++) //outputs are held to the end
+	{
+		ctx.registers.push_back(reg());
+		ctx.registers.back().symbolId = ctx.outputs[i];
+		ctx.registers.back().last = maxTimestep;
 	}
 
-	for (int i = 0; i < outputs.size(); i++)
+	for (int i = 0; i < ctx.registers.size(); i++) //first time written and last time read, from the def-use lists
 	{
-		registers.push_back(reg());
-		registers.back().name = outputs[i];
+		symbol& s = ctx.symbols[ctx.registers[i].symbolId];
+		s.reg = i;
 
-		for (int j = 0; j < m; j++) //if operation has this output as an out, first timestep = this timestep and last = something else
-			if (operations[j].output == outputs[i])
-				registers.back().first = operations[j].timestep;
+		if (s.producer != -1)
+			ctx.registers[i].first = ctx.operations[s.producer].timestep;
+		if (!s.consumers.empty())
+			ctx.registers[i].last = ctx.operations[s.consumers.back()].timestep;
+	}
+}
 
-		for (int j = 0; j < m; j++)
-			if (operations[j].timestep > maxTimestep)
-				maxTimestep = operations[j].timestep;
+//Registers conflict when their lifetimes overlap. Visited by first access,
+//the registers after one that can overlap it are the run that starts before
+//it ends, so one sweep finds every pair. In a deep schedule each value
+//overlaps only a few others, and the conflict lists are then far smaller
+//than the comp graph's matrix. Builds nothing and returns false as soon as
+//the lists would hold more entries than the matrix has words (n per row).
+bool buildRegisterConflicts(synthesisContext& ctx, conflict_graph* conflicts)
+{
+	int n = ctx.registers.size();
+	size_t limit = (size_t)n * n / COMPAT_WORD_BITS, entries = 0;
+	vector<int> order(n);
+	vector<size_t> fill(n, 0);
 
-		registers.back().last = maxTimestep;
+	for (int i = 0; i < n; i++)
+		order[i] = i;
+	stable_sort(order.begin(), order.end(), [&ctx](int a, int b) { return ctx.registers[a].first < ctx.registers[b].first; });
+
+	auto forEachConflict = [&ctx, &order, n](auto&& visit) { //false if visit asked to stop
+		for (int p = 0; p < n; p++)
+		{
+			const reg& a = ctx.registers[order[p]];
+			for (int q = p + 1; q < n && ctx.registers[order[q]].first < a.last; q++)
+				if (ctx.registers[order[q]].last > a.first && !visit(order[p], order[q]))
+					return false;
+		}
+		return true;
+	};
+
+	if (!forEachConflict([&fill, &entries, limit](int i, int j) { fill[i]++; fill[j]++; entries += 2; return entries <= limit; }))
+		return false;
+
+	conflict_graph_init(conflicts, n, entries, &ctx.regArena);
+	for (int i = 0; i < n; i++)
+	{
+		conflicts->offsets[i + 1] = conflicts->offsets[i] + fill[i];
+		fill[i] = conflicts->offsets[i];
 	}
+	forEachConflict([conflicts, &fill](int i, int j) {
+		conflicts->neighbors[fill[i]++] = j;
+		conflicts->neighbors[fill[j]++] = i;
+		return true;
+	});
+	parallelFor(ctx.pool, 0, n, 256, [conflicts](int first, int last) { //the partitioner wants each list in order
+		for (int i = first; i < last; i++)
+			sort(conflicts->neighbors + conflicts->offsets[i], conflicts->neighbors + conflicts->offsets[i + 1]);
+	});
+	return true;
+}
 
-	n = registers.size();
+void bindRegistersByClique(synthesisContext& ctx) //Tseng-Siewiorek clique partitioning of the comp graph
+{
+	int n = ctx.registers.size(); //length of a side of the compatibility matrix
+	clique_result cliques;
+	conflict_graph conflicts;
 
-	for (int i = 0; i < n; i++) //need to determine first time accessed and last time accessed for each edge aka register
-		for (int j = 0; j < m; j++)
-			if (operations[j].output == registers[i].name) //if output is our reg, first time it is written to
-				registers[i].first = operations[j].timestep;
-			else if ((operations[j].operand1 == registers[i].name) ||
-				(operations[j].operand2 == registers[i].name)) // if either input is our reg, last time it is read.
-				registers[i].last = operations[j].timestep;
+	if (buildRegisterConflicts(ctx, &conflicts)) //sparse: partition the complement, same cliques
+	{
+		clique_partition(&conflicts, &cliques, ctx.pool, &cliqueSearch);
+		conflict_graph_free(&conflicts);
+	}
+	else
+	{
+		compat_matrix_init(&ctx.regCompGraph, n, &ctx.regArena); //bit-packed comp graph, all edges cleared
+
+		//compatible: lifetimes do not overlap (and every register with itself)
+		disjointLifetimeKernel kernel(n);
+		for (int i = 0; i < n; i++)
+		{
+			kernel.first[i] = ctx.registers[i].first;
+			kernel.last[i] = ctx.registers[i].last;
+		}
+		buildSymmetricMatrix(&ctx.regCompGraph, kernel, ctx.pool);
+		clique_partition(&ctx.regCompGraph, &cliques, ctx.pool, &cliqueSearch);
+	}
 
-	regCompGraph = new int*[n];
+	for (int i = 0; i < cliques.num_cliques; i++)
+		ctx.regResources.push_back(vector<int>(clique_members(&cliques, i),
+			clique_members(&cliques, i) + clique_size(&cliques, i)));
+	ctx.regPartition = cliques.stats;
+	clique_result_free(&cliques);
+}
 
-	for (int i = 0; i < n; i++) //declare empty comp graph filled with junk data
-		regCompGraph[i] = new int[n];
+//Registers are compatible exactly when their lifetimes do not overlap, so the
+//comp graph is an interval graph and the left-edge algorithm colors it with the
+//minimum number of registers in O(n log n): visit lifetimes by first access and
+//reuse the register that frees up earliest, if it is free by then. A value that
+//is written but never read keeps last = 0, which is <= every first, so it is
+//compatible with every register and goes into register 0 in O(1).
+void bindRegistersLeftEdge(synthesisContext& ctx)
+{
+	int n = ctx.registers.size();
+	vector<int> order, dead;
+	priority_queue<pair<int, int>, vector<pair<int, int> >, greater<pair<int, int> > > freeAt; //(last, register #)
 
 	for (int i = 0; i < n; i++)
-		for (int j = 0; j < n; j++)
-			if ((i == j) || (registers[i].last <= registers[j].first) || (registers[i].first >= registers[j].last))
-			{
-				regCompGraph[i][j] = 1;
-				regCompGraph[j][i] = 1;
-			}
-			else {
-				regCompGraph[i][j] = 0;
-				regCompGraph[j][i] = 0;
-			}
-
-			clique_partition(regCompGraph, n);
-
-			int opIndex;
-			string type;
-
-			for (int i = 0; i < MAXCLIQUES; i++)
-			{
-				if (clique_set[i].size == UNKNOWN) break;
-				regResources.push_back(vector<int>());
-
-				for (int j = 0; j < MAXCLIQUES; j++)
-					if (clique_set[i].members[j] != UNKNOWN)
-						regResources[i].push_back(clique_set[i].members[j]);
-					else
-						break;
-			}
+		if (ctx.registers[i].last < ctx.registers[i].first)
+			dead.push_back(i); //written but never read: not an interval, placed at the end
+		else
+			order.push_back(i);
+
+	stable_sort(order.begin(), order.end(), [&ctx](int a, int b) {
+		if (ctx.registers[a].first != ctx.registers[b].first)
+			return ctx.registers[a].first < ctx.registers[b].first;
+		return ctx.registers[a].last < ctx.registers[b].last;
+	});
+
+	for (int k = 0; k < order.size(); k++)
+	{
+		int regIndex = order[k], resIndex;
+
+		if (!freeAt.empty() && freeAt.top().first <= ctx.registers[regIndex].first)
+		{
+			resIndex = freeAt.top().second; //reuse: previous value is dead by the time this one is written
+			freeAt.pop();
+		}
+		else {
+			resIndex = ctx.regResources.size();
+			ctx.regResources.push_back(vector<int>());
+		}
+
+		ctx.regResources[resIndex].push_back(regIndex);
+		freeAt.push(make_pair(ctx.registers[regIndex].last, resIndex));
+	}
+
+	for (int k = 0; k < dead.size(); k++) //the first register, the one the comp graph test would find
+	{
+		if (ctx.regResources.empty())
+			ctx.regResources.push_back(vector<int>());
+		ctx.regResources[0].push_back(dead[k]);
+	}
 }
+
+void allocateRegisters(synthesisContext& ctx)
+{
+	computeRegisterLifetimes(ctx);
+
+	if (registerBinder == REG_BIND_LEFT_EDGE)
+		bindRegistersLeftEdge(ctx);
+	else
+		bindRegistersByClique(ctx);
+}
+
+#endif
@@ -1,6 +1,14 @@
+#ifndef CLIQUE_PARTITION_H
+#define CLIQUE_PARTITION_H
+
 #include "stdio.h" 
 #include "stdlib.h"
 #include "assert.h"
+#include "compat_matrix.h"
+#include "conflict_graph.h"
+#include "log.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
 
 /****************************************************************************
 *  This is a C implementation of the Tseng and Seiworick's Clique
@@ -16,29 +24,74 @@
 *
 *  Implementation Details:
 *
-*   Input: Two dimensional symmetric compatibility array
-*   where compat[i][j] = 1  if nodes i and j are compatible
-*                     = 0  otherwise
+*   Input: Bit-packed symmetric compatibility matrix (compat_matrix.h)
+*   where bit (i,j) = 1  if nodes i and j are compatible
+*                   = 0  otherwise
+*   The old two dimensional int array is still accepted and packed.
+*   A sparse graph can instead be given as its complement, a CSR list of
+*   the incompatible pairs (conflict_graph.h); the partition is the same.
 *
 *   Output: Set of cliques
-*   A global array "clique_set" stores the results.
-*   Each clique has a (1) list of members, a integer array of nodeid's
-*   (2) the number of members information.
-*   All the entries are initialized to UNKNOWN values.
+*   A clique_result filled in by the partitioner stores the results in
+*   compressed (CSR) form: one flat array of node ids, clique after
+*   clique, and num_cliques + 1 offsets into it.  Clique k is
+*       members[offsets[k]] .. members[offsets[k+1] - 1]
+*   Every node is in exactly one clique, so there is no limit on the
+*   number or size of the cliques.
 *
-*   o The maximum number of cliques is 200.  This can be changes by
-*     changing the hash define value of MAXCLIQUES.
-*   o Call clique_partition(compatibility array, nodesize)
+*   o Call clique_partition(&compat_matrix, &result [, pool]),
+*          clique_partition(&conflict_graph, &result [, pool]) or
+*          clique_partition(compatibility array, nodesize, &result)
+*     and release the result with clique_result_free().  Given a
+*     thread pool (thread_pool.hpp), big merge steps score their
+*     candidates on it; the cliques are the same with or without it.
+*   o A clique_search (the last argument) asks for several starts with
+*     the ties broken in different seeded orders; see search_partitions.
 *   o The output can be printed using print_clique_set() function.
-*   o Compile this code without DEBUG option
-*
-*       unix% gcc -g clique_partition.c
+*   o Tracing goes through log.hpp.  The banner and the clique set are
+*     LOG_DEBUG, the matrix dump, the sanity-check progress and the merge
+*     internals LOG_TRACE; both are compiled out unless the build raises
+*     LOG_COMPILED_LEVEL, e.g.
 *
-*   o To enable DEBUG option:
+*       unix% g++ -g -DLOG_COMPILED_LEVEL=4 dcs.cpp      (or -DDEBUG)
 *
-*       unix% gcc -g -DDEBUG clique_partition.c
+*     and are then shown with --log=debug or --log=trace.
 *
 *  Modification History:
+*   o The compatibility array is a bit-packed matrix.  The partitioner no
+*     longer makes a local copy of it; node degrees, set Y and the I_y
+*     sets are computed with word-wide AND / popcount kernels over the
+*     rows and a bitset of the nodes still in N.
+*   o Node degrees are kept in a bucket queue and updated as nodes leave
+*     N, instead of rebuilding an n x n degrees matrix for every clique.
+*   o Y is kept as a bitset and updated as nodes merge; |I_y| and the
+*     I_y / Y intersections are popcounts.  The scratch arrays live in a
+*     workspace allocated once per partition (nothing leaks per merge).
+*   o The matrix and the workspace come from a synthesis-run arena
+*     (synth_arena.h) when the caller provides one.
+*   o No global state: a call writes only its clique_result, its own
+*     workspace and the matrix's arena, so designs with separate arenas
+*     can be partitioned on separate threads.
+*   o Every call counts its cliques, merge steps and candidate sets in
+*     clique_result.stats for profiling.
+*   o The unconditional printf tracing (the whole matrix, a dot per
+*     checked cell) and the #ifdef DEBUG blocks are leveled log.hpp
+*     messages, so a normal build prints nothing from here.
+*   o A conflict graph runs through the same steps: N and Y stay
+*     bitsets, but the degrees, Y and each node's conflicts in Y are
+*     updated from the conflict lists as nodes leave, O(conflicts) per
+*     clique, so a merge step costs O(|Y|) instead of O(|Y| n / 64) and
+*     the graph takes memory in proportion to its conflicts.  Ties are
+*     broken the same way as for the matrix.
+*   o The candidates of a merge step (|I_y| and the Y1 cardinalities)
+*     are scored independently, so steps with enough work split them
+*     over a thread pool.  Each task writes only its own candidates'
+*     entries and the min / max selections then run in position order,
+*     so the node merged does not depend on the number of threads.
+*   o Ties left after the heuristic's criteria (x among the nodes of
+*     highest degree, y in Y2) go through a seeded rank.  Seed 0 is the
+*     original order; other seeds give other valid partitions, and a
+*     multi-start search keeps the best of several within a time budget.
 *
 *  Acknowledgment:
 *--  This code is developed as part of the AUDI (AUtomatic 	    --
@@ -100,279 +153,630 @@
 */
 
 #define UNKNOWN -12345
-#define MAXCLIQUES 200
 
 #define CLIQUE_UNKNOWN -12345  
 #define CLIQUE_TRUE 100
 #define CLIQUE_FALSE 110 
 
-struct clique
+#ifndef CLIQUE_PARALLEL_WORK
+#define CLIQUE_PARALLEL_WORK (1L << 18)  /* scoring work (words or list entries) before a merge step is split */
+#endif
+#ifndef CLIQUE_TASK_WORK
+#define CLIQUE_TASK_WORK (1L << 16)      /* scoring work per task once it is */
+#endif
+
+/* work done by one clique_partition() call; a few adds per merge step */
+struct clique_stats
 {
-	int members[MAXCLIQUES];           /* members of the clique */
-	int size;                          /* number of members in the clique */
+	long nodes;
+	long cliques;                      /* cliques formed */
+	long merge_steps;                  /* nodes merged into a growing clique */
+	long candidate_evaluations;        /* |Y| summed over merge steps; each y in Y is scored once per step */
+	long max_setY;                     /* largest |Y| seen */
+	long tied_candidates;              /* |Y1| summed: candidates left tied after the first criterion */
+	long starts;                       /* partitions completed by a search (1 without one) */
+	long best_start;                   /* the start kept; 0 is the unseeded order */
 };
 
-struct clique clique_set[MAXCLIQUES];   /* stores the clique partitioning results */
+/* what a multi-start search keeps */
+enum clique_goal
+{
+	CLIQUE_FEWEST,                     /* fewest cliques, then fewest mux inputs */
+	CLIQUE_FEWEST_MUX_INPUTS           /* fewest mux inputs, then fewest cliques */
+};
 
-										/********************************************************************************/
+/* several partitions of one graph, ties broken differently in each */
+struct clique_search
+{
+	int starts;                        /* partitions to try; start 0 is always the unseeded order */
+	unsigned long seed;                /* start k > 0 breaks ties with seed + k */
+	double budget_ms;                  /* wall clock for the whole search, 0 for none */
+	enum clique_goal goal;
+};
+
+struct clique_result
+{
+	int num_cliques;                   /* number of cliques found */
+	int* offsets;                      /* num_cliques + 1 entries into members */
+	int* members;                      /* node ids of all cliques, one after another */
+	int nodesize;
+	synth_arena* arena;                /* where offsets and members come from */
+	struct clique_stats stats;
+};
 
-int input_sanity_check(int** compat, int array_dimension)
+int clique_size(const struct clique_result* result, int k)
 {
-	/* Verifies whether the compat array passed is valid array
-	*  (1) Is each array entry =0 or 1?
-	*  (2) Is the matrix symmetric
+	return result->offsets[k + 1] - result->offsets[k];
+}
+
+const int* clique_members(const struct clique_result* result, int k)
+{
+	return result->members + result->offsets[k];
+}
+
+void clique_result_free(struct clique_result* result)
+{
+	arena_free(result->arena, result->offsets, (result->nodesize + 1) * sizeof(int));
+	arena_free(result->arena, result->members, (result->nodesize + 1) * sizeof(int));
+	result->offsets = (int*)NULL;
+	result->members = (int*)NULL;
+	result->num_cliques = 0;
+}
+
+/********************************************************************************/
+
+int input_sanity_check(const compat_matrix* compat)
+{
+	/* Verifies whether the compat matrix passed is valid
+	*  (1) Is the matrix symmetric
+	* Entries are single bits, so they are always 0 or 1.
 	* Note that diagnol entries can be either 0 or 1.
 	*/
 
 	int i = CLIQUE_UNKNOWN;
 	int j = CLIQUE_UNKNOWN;
-	printf(" Checking the sanity of the input..");
+	logPrintf<LOG_TRACE>(" Checking the sanity of the input..");
 
-	for (i = 0; i< array_dimension; i++)
+	for (i = 0; i< compat->nodesize; i++)
 	{
-		for (j = 0; j< array_dimension; j++)
+		for (j = 0; j< compat->nodesize; j++)
 		{
-			if ((compat[i][j] != 1) && (compat[i][j] != 0))
-			{
-				printf(" %d \n", compat[i][j]);
-				printf("The value of an array element is other than 1 or 0. Aborting..\n");
-				exit(0);
-			}
-			if (compat[i][j] != compat[j][i])
+			if (compat_test(compat, i, j) != compat_test(compat, j, i))
 			{
-				printf("The compatibility array is NOT symmetric at (%d,%d) and (%d,%d) Aborting..\n", i, j, j, i);
+				logPrintf<LOG_ERROR>("The compatibility array is NOT symmetric at (%d,%d) and (%d,%d) Aborting..\n", i, j, j, i);
 				exit(0);
 			}
-			printf(".");
 		}
+		if (logEnabled<LOG_TRACE>())  /* a dot per cell, a row at a time */
+			logPrintf<LOG_TRACE>("%s", string(compat->nodesize, '.').c_str());
 	}
-	printf("Done.\n");
+	logPrintf<LOG_TRACE>("Done.\n");
 	return CLIQUE_TRUE;
 }
 
-int output_sanity_check(int array_dimension, int** local_compat, int** compat)
+int output_sanity_check(const compat_matrix* compat, const struct clique_result* result)
 {
 	/*
 	* Verifies the results of the heuristic.
+	* every node is in exactly one clique, and
 	* for each clique do
-	*   if the clique size is UNKNOWN
-	*      break
-	*   else
-	*     for every pair of members x and y in clique do
-	*       assert  compat[x][y] = 1 and compat[y][x] = 1
-	*     end for
-	*   end if
+	*   for every pair of members x and y in clique do
+	*     assert  compat[x][y] = 1 and compat[y][x] = 1
+	*   end for
 	* end for
 	*/
 	int i = UNKNOWN, j = UNKNOWN, k = UNKNOWN;
 	int member1 = UNKNOWN, member2 = UNKNOWN;
+	const int* members = (const int*)NULL;
 
-	printf("\n Verifying the results of the clique partitioning algorithm..");
-	for (i = 0; i<MAXCLIQUES; i++)
+	logPrintf<LOG_TRACE>("\n Verifying the results of the clique partitioning algorithm..");
+	assert(result->offsets[0] == 0);
+	assert(result->offsets[result->num_cliques] == compat->nodesize);
+	for (i = 0; i<result->num_cliques; i++)
 	{
-		if (clique_set[i].size != UNKNOWN)
+		assert(clique_size(result, i) > 0);
+		members = clique_members(result, i);
+		for (j = 0; j < clique_size(result, i); j++)
 		{
-			assert(clique_set[i].size > 0);
-			for (j = 0; j < clique_set[i].size; j++)
+			for (k = 0; k < clique_size(result, i); k++)
 			{
-				for (k = 0; k < clique_set[i].size; k++)
+				if (j != k)
 				{
-					if (j != k)
-					{
-						member1 = clique_set[i].members[j];
-						member2 = clique_set[i].members[k];
-
-						assert(compat[member1][member2] == 1);
-						assert(compat[member2][member1] == 1);
-						assert(local_compat[member2][member1] == 1);
-						assert(local_compat[member2][member1] == 1);
-						printf(".");
-					}
+					member1 = members[j];
+					member2 = members[k];
+
+					assert(compat_test(compat, member1, member2) == 1);
+					assert(compat_test(compat, member2, member1) == 1);
 				}
 			}
 		}
+		if (logEnabled<LOG_TRACE>())  /* a dot per ordered member pair */
+			logPrintf<LOG_TRACE>("%s", string(clique_size(result, i) * (clique_size(result, i) - 1), '.').c_str());
 	}
-	printf("..Done.\n");
+	logPrintf<LOG_TRACE>("..Done.\n");
 	return CLIQUE_TRUE;
 }
 
+int get_degree_of_a_node(int x, const compat_matrix* compat, const compat_word* node_set)
+{
+	/* |row(x) & N| not counting x itself */
+	int node_degree = bits_and_popcount(compat_row(compat, x), node_set, compat->row_words);
+
+	if (bits_test(node_set, x) && compat_test(compat, x, x))
+		node_degree--;
+
+	return node_degree;
+}
 
-void make_a_local_copy(int** local_compat, int** compat, int nodesize)
+int* arena_alloc_ints(synth_arena* arena, int count)
 {
-	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
+	return (int*)arena_alloc(arena, count * sizeof(int));
+}
 
-	for (i = 0; i<nodesize; i++)
+void arena_free_ints(synth_arena* arena, int* p, int count)
+{
+	arena_free(arena, p, count * sizeof(int));
+}
+
+int input_sanity_check(const conflict_graph* conflicts)
+{
+	/* Verifies whether the conflict lists passed are valid
+	*  (1) every list is sorted, in range and does not hold its own node
+	*  (2) the lists are symmetric
+	*/
+	int i = CLIQUE_UNKNOWN, k = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
+	const int* list = (const int*)NULL;
+
+	logPrintf<LOG_TRACE>(" Checking the sanity of the input..");
+
+	for (i = 0; i < conflicts->nodesize; i++)
 	{
-		for (j = 0; j<nodesize; j++)
+		list = conflict_list(conflicts, i);
+		for (k = 0; k < conflict_degree(conflicts, i); k++)
 		{
-			local_compat[i][j] = compat[i][j];
+			j = list[k];
+			if (j < 0 || j >= conflicts->nodesize || j == i || (k > 0 && list[k - 1] >= j))
+			{
+				logPrintf<LOG_ERROR>("The conflict list of node %d is not sorted, in range and without %d at entry %d. Aborting..\n", i, i, k);
+				exit(0);
+			}
+			if (!conflict_test(conflicts, j, i))
+			{
+				logPrintf<LOG_ERROR>("The conflict graph is NOT symmetric at (%d,%d) and (%d,%d) Aborting..\n", i, j, j, i);
+				exit(0);
+			}
 		}
+		if (logEnabled<LOG_TRACE>())  /* a dot per listed pair */
+			logPrintf<LOG_TRACE>("%s", string(conflict_degree(conflicts, i), '.').c_str());
 	}
-	return;
+	logPrintf<LOG_TRACE>("Done.\n");
+	return CLIQUE_TRUE;
 }
 
-int get_degree_of_a_node(int x, int nodesize, int** local_compat, int* node_set)
+int output_sanity_check(const conflict_graph* conflicts, const struct clique_result* result)
 {
-	int j = CLIQUE_UNKNOWN, node_degree = CLIQUE_UNKNOWN;
+	/* Verifies the results of the heuristic: every node is in exactly one
+	*  clique and no node conflicts with another member of its clique.
+	*  Each node is tagged with its clique, so this is O(n + conflicts).
+	*/
+	int* clique_of = arena_alloc_ints(result->arena, conflicts->nodesize);
+	int i = CLIQUE_UNKNOWN, k = CLIQUE_UNKNOWN, member = CLIQUE_UNKNOWN;
+
+	logPrintf<LOG_TRACE>("\n Verifying the results of the clique partitioning algorithm..");
+	assert(result->offsets[0] == 0);
+	assert(result->offsets[result->num_cliques] == conflicts->nodesize);
+	for (i = 0; i < conflicts->nodesize; i++)
+		clique_of[i] = CLIQUE_UNKNOWN;
+	for (i = 0; i < result->num_cliques; i++)
+	{
+		assert(clique_size(result, i) > 0);
+		for (k = 0; k < clique_size(result, i); k++)
+		{
+			member = clique_members(result, i)[k];
+			assert(clique_of[member] == CLIQUE_UNKNOWN);
+			clique_of[member] = i;
+		}
+	}
+	for (member = 0; member < conflicts->nodesize; member++)
+	{
+		for (k = 0; k < conflict_degree(conflicts, member); k++)
+			assert(clique_of[conflict_list(conflicts, member)[k]] != clique_of[member]);
+		if (logEnabled<LOG_TRACE>())
+			logPrintf<LOG_TRACE>(".");
+	}
+	logPrintf<LOG_TRACE>("..Done.\n");
+	arena_free_ints(result->arena, clique_of, conflicts->nodesize);
+	return CLIQUE_TRUE;
+}
+
+/********************************************************************************
+*  Degree bucket queue
+*
+*  Every node still in N sits in the bucket of its current degree (number of
+*  compatible nodes in N).  Buckets are doubly linked lists, so a node moves
+*  between buckets in O(1).  Degrees only go down as nodes leave N, so the
+*  max_degree pointer only moves down and select_new_node() finds the top
+*  bucket in O(1) amortized.  Removing a node updates only its neighbors.
+*
+*  For a conflict graph the key of a node is nodesize - 1 - (its conflicts
+*  in N).  That is its degree plus the number of nodes already gone from N,
+*  the same for every node, so the buckets order the nodes exactly as the
+*  degrees do, but removing a node only touches its conflicts (whose keys
+*  go up by one) instead of all of its compatible neighbors.
+********************************************************************************/
+
+struct degree_queue
+{
+	synth_arena* arena;
+	int nodesize;
+	int max_degree;     /* no bucket above this one is occupied */
+	int* degree;        /* degree[i] = degree of node i in N */
+	int* head;          /* head[d] = first node with degree d, or CLIQUE_UNKNOWN */
+	int* next;          /* next / prev node in the same bucket */
+	int* prev;
+};
+
+void degree_queue_unlink(struct degree_queue* q, int x)
+{
+	if (q->prev[x] != CLIQUE_UNKNOWN)
+		q->next[q->prev[x]] = q->next[x];
+	else
+		q->head[q->degree[x]] = q->next[x];
+	if (q->next[x] != CLIQUE_UNKNOWN)
+		q->prev[q->next[x]] = q->prev[x];
+}
+
+void degree_queue_push(struct degree_queue* q, int x)
+{
+	int d = q->degree[x];
+
+	q->prev[x] = CLIQUE_UNKNOWN;
+	q->next[x] = q->head[d];
+	if (q->head[d] != CLIQUE_UNKNOWN)
+		q->prev[q->head[d]] = x;
+	q->head[d] = x;
+	if (d > q->max_degree)
+		q->max_degree = d;
+}
+
+void degree_queue_alloc(struct degree_queue* q, int nodesize, synth_arena* arena)
+{
+	int i = CLIQUE_UNKNOWN;
 
-	node_degree = 0;
-	for (j = 0; j<nodesize; j++) /* compute node degrees */
+	q->arena = arena;
+	q->nodesize = nodesize;
+	q->max_degree = 0;
+	q->degree = arena_alloc_ints(q->arena, nodesize);
+	q->head = arena_alloc_ints(q->arena, nodesize + 1);
+	q->next = arena_alloc_ints(q->arena, nodesize);
+	q->prev = arena_alloc_ints(q->arena, nodesize);
+
+	for (i = 0; i <= nodesize; i++)
+	{
+		q->head[i] = CLIQUE_UNKNOWN;
+	}
+}
+
+void degree_queue_init(struct degree_queue* q, const compat_matrix* compat, const compat_word* node_set, synth_arena* arena)
+{
+	int nodesize = compat->nodesize;
+	int i = CLIQUE_UNKNOWN;
+
+	degree_queue_alloc(q, nodesize, arena);
+
+	for (i = nodesize - 1; i >= 0; i--)
 	{
-		if (node_set[j] != CLIQUE_UNKNOWN)
+		if (bits_test(node_set, i))
 		{
-			if (x != j)
-				node_degree += local_compat[x][j];
+			q->degree[i] = get_degree_of_a_node(i, compat, node_set);
+			degree_queue_push(q, i);
 		}
 	}
+}
 
-	return node_degree;
+void degree_queue_init(struct degree_queue* q, const conflict_graph* conflicts, const compat_word* node_set, synth_arena* arena)
+{
+	/* keys as described above; node_set must hold every node */
+	int nodesize = conflicts->nodesize;
+	int i = CLIQUE_UNKNOWN;
+
+	degree_queue_alloc(q, nodesize, arena);
+
+	for (i = nodesize - 1; i >= 0; i--)
+	{
+		assert(bits_test(node_set, i));
+		q->degree[i] = nodesize - 1 - conflict_degree(conflicts, i);
+		degree_queue_push(q, i);
+	}
+}
+
+void degree_queue_free(struct degree_queue* q)
+{
+	arena_free_ints(q->arena, q->degree, q->nodesize);
+	arena_free_ints(q->arena, q->head, q->nodesize + 1);
+	arena_free_ints(q->arena, q->next, q->nodesize);
+	arena_free_ints(q->arena, q->prev, q->nodesize);
 }
 
-int select_new_node(int** local_compat, int nodesize, int* node_set)
+void remove_node_from_N(int x, const compat_matrix* compat, compat_word* node_set, struct degree_queue* q)
+{
+	/* N <- N - {x}; every neighbor of x left in N loses one degree */
+	const compat_word* row_x = compat_row(compat, x);
+	int w = CLIQUE_UNKNOWN, u = CLIQUE_UNKNOWN;
+	compat_word bits = 0;
+
+	bits_clear(node_set, x);
+	degree_queue_unlink(q, x);
+
+	for (w = 0; w < compat->row_words; w++)
+	{
+		for (bits = row_x[w] & node_set[w]; bits != 0; bits &= bits - 1)
+		{
+			u = w * COMPAT_WORD_BITS + lowest_bit(bits);
+			degree_queue_unlink(q, u);
+			q->degree[u]--;
+			degree_queue_push(q, u);
+		}
+	}
+}
+
+void remove_node_from_N(int x, const conflict_graph* conflicts, compat_word* node_set, struct degree_queue* q)
+{
+	/* N <- N - {x}; every conflict of x left in N has one conflict fewer */
+	const int* list = conflict_list(conflicts, x);
+	int k = CLIQUE_UNKNOWN, u = CLIQUE_UNKNOWN;
+
+	bits_clear(node_set, x);
+	degree_queue_unlink(q, x);
+
+	for (k = 0; k < conflict_degree(conflicts, x); k++)
+	{
+		u = list[k];
+		if (bits_test(node_set, u))
+		{
+			degree_queue_unlink(q, u);
+			q->degree[u]++;
+			degree_queue_push(q, u);
+		}
+	}
+}
+
+unsigned long long tie_rank(unsigned long seed, int node)
+{
+	/* order among tied nodes: the node id for seed 0, otherwise a hash
+	*  of (seed, node) with the id in the low half so no two nodes tie */
+	unsigned long long h = 0;
+
+	if (seed == 0)
+		return (unsigned long long)node;
+	h = (unsigned long long)seed * 0x9E3779B97F4A7C15ULL + (unsigned long long)node;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return (h & 0xFFFFFFFF00000000ULL) | (unsigned int)node;
+}
+
+int select_new_node(struct degree_queue* q, unsigned long seed)
 {
 	/*    if a node with priority, then pick that node
 	*      else a node with highest degree
 	*        if multiple nodes then pick a node
 	*           with highest neighbor wt
 	*             if multiple pick one randomly.
+	*
+	*  The neighbor weight of a node is its degree in N, so within the top
+	*  bucket ties always fall through to tie_rank(); the highest rank wins,
+	*  which for seed 0 is the highest index, the order the heuristic has
+	*  always produced.
 	*/
-	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
-	int** degrees;
-	degrees = new int*[nodesize];
-
-	for (int i = 0; i < nodesize; i++) //declare empty comp graph filled with junk data
-		degrees[i] = new int[nodesize];
-	int max_degree = CLIQUE_UNKNOWN;
-	int curr_max_degree = CLIQUE_UNKNOWN;
-	int curr_node_degree = CLIQUE_UNKNOWN;
-	int index = CLIQUE_UNKNOWN, curr_node = CLIQUE_UNKNOWN;
+	int curr_node = CLIQUE_UNKNOWN;
 	int max_curr_neighbors_wt = CLIQUE_UNKNOWN;
 	int curr_neighbors_wt = CLIQUE_UNKNOWN;
 	int max_node = CLIQUE_UNKNOWN;
 
-	for (i = 0; i<nodesize; i++) /* initialize the degrees matrix */
-	{  /* i dimension = node degree */
-		for (j = 0; j<nodesize; j++)
-		{  /* j dimension = node with degree=i */
-			degrees[i][j] = CLIQUE_UNKNOWN;
+	while (q->max_degree > 0 && q->head[q->max_degree] == CLIQUE_UNKNOWN)
+		q->max_degree--;
+
+	max_curr_neighbors_wt = 0;
+	for (curr_node = q->head[q->max_degree]; curr_node != CLIQUE_UNKNOWN; curr_node = q->next[curr_node])
+		/* go through all nodes with max_degree */
+	{
+		curr_neighbors_wt = q->degree[curr_node];
+		logPrintf<LOG_TRACE>("curr_node = %d curr_neighbors_wt=%d\n", curr_node, curr_neighbors_wt);
+		if ((curr_neighbors_wt > max_curr_neighbors_wt) ||
+			(curr_neighbors_wt == max_curr_neighbors_wt && (max_node == CLIQUE_UNKNOWN || tie_rank(seed, curr_node) > tie_rank(seed, max_node))))
+		{
+			max_curr_neighbors_wt = curr_neighbors_wt;
+			max_node = curr_node;
 		}
 	}
+	logPrintf<LOG_TRACE>(" curr_max_degree = %d max_node= %d\n", q->max_degree, max_node);
 
-	curr_max_degree = 0;
-	curr_node_degree = 0;
+	return max_node;
+}
 
-	for (i = 0; i<nodesize; i++)  /* for each node do */
-	{
-		if (node_set[i] != CLIQUE_UNKNOWN)  /* if the node is still in N */
-		{
-			curr_node_degree = get_degree_of_a_node(i, nodesize, local_compat, node_set);
+/********************************************************************************
+*  Per-partition workspace
+*
+*  All scratch storage used while forming cliques is allocated once per call
+*  to clique_partition() from the compat matrix's arena (synth_arena.h) and
+*  reused for every clique and every merge step.
+*  Sets over the nodes (N, Y) are bitsets laid out like a compat_matrix row;
+*  the index lists are CLIQUE_UNKNOWN terminated like the rest of this file.
+********************************************************************************/
+
+struct partition_workspace
+{
+	synth_arena* arena;             /* the compat matrix's arena */
+	int nodesize;
+	int row_words;
+	compat_word* node_set;          /* N: bit i set if node i is still in N */
+	compat_word* setY_bits;         /* Y as a bitset */
+	int* current_clique;            /* members of the clique being formed */
+	int* setY;                      /* members of Y in index order */
+	int* sizes_of_sets_I_y;         /* |I_y|, indexed by node */
+	int* cards;                     /* |intersection(I_y, Y)|, indexed by position in Y */
+	int* conflicts_in_Y;            /* conflict graphs: |conflicts(y) & Y| for every y in Y */
+	int* set_Y1;
+	int* set_Y2;
+	int setY1_size;                 /* |Y1| of the last merge step */
+	struct degree_queue degrees;
+	workStealingPool* pool;         /* scores big merge steps, or NULL */
+	unsigned long seed;             /* tie_rank() order of this partition */
+};
 
-#ifdef DEBUG
-			printf(" node=%d curr_node_degree = %d \n", i, curr_node_degree);
-#endif
-			if (curr_node_degree > curr_max_degree)
-			{
-				curr_max_degree = curr_node_degree;
-			}
+void workspace_init(struct partition_workspace* ws, int nodesize, int row_words, synth_arena* arena)
+{
+	/* the degree queue is set up by the caller, from its kind of graph */
+	int i = CLIQUE_UNKNOWN;
 
-			/* append to a list of nodes with degree=curr_node_degree */
-			index = 0;
-			while (degrees[curr_node_degree][index] != CLIQUE_UNKNOWN) index++;
-			degrees[curr_node_degree][index] = i; /* register this node */
-		}
-	}
+	ws->arena = arena;
+	ws->nodesize = nodesize;
+	ws->row_words = row_words;
+	ws->node_set = compat_alloc_words(ws->arena, ws->row_words);
+	ws->setY_bits = compat_alloc_words(ws->arena, ws->row_words);
+	ws->current_clique = arena_alloc_ints(ws->arena, nodesize);
+	ws->setY = arena_alloc_ints(ws->arena, nodesize + 1);
+	ws->sizes_of_sets_I_y = arena_alloc_ints(ws->arena, nodesize);
+	ws->cards = arena_alloc_ints(ws->arena, nodesize);
+	ws->conflicts_in_Y = arena_alloc_ints(ws->arena, nodesize);
+	ws->set_Y1 = arena_alloc_ints(ws->arena, nodesize + 1);
+	ws->set_Y2 = arena_alloc_ints(ws->arena, nodesize + 1);
 
-	/* for debugging purposes..
-	for (i=0; i<nodesize; i++)
-	{
-	for (j=0; j<nodesize; j++)
+	for (i = 0; i<nodesize; i++)
 	{
-	printf(" %d %d %d \n", i, j, degrees[i][j]);
-	}
+		ws->current_clique[i] = CLIQUE_UNKNOWN;
+		bits_set(ws->node_set, i);
 	}
-	*/
-	if (degrees[curr_max_degree][1] == CLIQUE_UNKNOWN) /* only one max node */
-		max_node = degrees[curr_max_degree][0];
-	else
-		if (degrees[curr_max_degree][1] != CLIQUE_UNKNOWN) /* multiple max nodes */
-		{
-			index = 0;
-			max_curr_neighbors_wt = 0;
+	ws->setY[0] = CLIQUE_UNKNOWN;
+	ws->pool = (workStealingPool*)NULL;
+	ws->seed = 0;
+}
 
-			for (index = 0; index<nodesize; index++)
-				/* go through all nodes with curr_max_degree*/
-			{
-				if (degrees[curr_max_degree][index] != CLIQUE_UNKNOWN)
-					/* not end of list of the nodes with curr_max_degree */
-				{
-					curr_neighbors_wt = 0;
-					curr_node = degrees[curr_max_degree][index];
-
-					/* get cumulative neighbor weight for this node */
-					curr_neighbors_wt += get_degree_of_a_node(curr_node, nodesize,
-						local_compat, node_set);
-#ifdef DEBUG
-					printf("curr_node = %d curr_neighbors_wt=%d\n", curr_node, curr_neighbors_wt);
-#endif
-					/* Is the local_compat, node_set consistent? */
-					if (curr_neighbors_wt >= max_curr_neighbors_wt)
-					{
-						max_curr_neighbors_wt = curr_neighbors_wt;
-						max_node = curr_node;
-					}
-				}
-			}
-		}
-#ifdef DEBUG
-	printf(" curr_max_degree = %d max_node= %d\n", curr_max_degree, max_node);
-#endif
+void workspace_free(struct partition_workspace* ws)
+{
+	compat_free_words(ws->arena, ws->node_set, ws->row_words);
+	compat_free_words(ws->arena, ws->setY_bits, ws->row_words);
+	arena_free_ints(ws->arena, ws->current_clique, ws->nodesize);
+	arena_free_ints(ws->arena, ws->setY, ws->nodesize + 1);
+	arena_free_ints(ws->arena, ws->sizes_of_sets_I_y, ws->nodesize);
+	arena_free_ints(ws->arena, ws->cards, ws->nodesize);
+	arena_free_ints(ws->arena, ws->conflicts_in_Y, ws->nodesize);
+	arena_free_ints(ws->arena, ws->set_Y1, ws->nodesize + 1);
+	arena_free_ints(ws->arena, ws->set_Y2, ws->nodesize + 1);
+	degree_queue_free(&ws->degrees);
+}
 
-	return max_node;
+int size_of_I_y(struct partition_workspace* ws, const compat_matrix* compat, int y)
+{
+	/* |I_y| = | N & ~row(y) | */
+	return bits_andnot_popcount(ws->node_set, compat_row(compat, y), compat->row_words);
 }
 
-int form_setY(int* setY, int* current_clique, int** local_compat, int nodesize, int* node_set)
+int size_of_I_y(struct partition_workspace* ws, const conflict_graph* conflicts, int y)
 {
-	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN, index = CLIQUE_UNKNOWN;
-	int setY_size = CLIQUE_UNKNOWN;
-	int compatibility = CLIQUE_UNKNOWN;
+	/* | N & conflicts(y) |, read back from y's key in the degree queue */
+	return conflicts->nodesize - 1 - ws->degrees.degree[y];
+}
 
-	index = 0;
-	setY_size = 0;
+int form_setY(struct partition_workspace* ws, const compat_matrix* compat, int new_member, int new_clique)
+{
+	/* Y = N & row(c) for every member c of the current clique.  N only
+	*  shrinks, so after merging new_member Y is the old Y & row(new_member) & N.
+	*/
+	int w = CLIQUE_UNKNOWN, index = CLIQUE_UNKNOWN;
+	const compat_word* row = compat_row(compat, new_member);
+	compat_word bits = 0;
 
-	/* reset set_Y */
-	for (i = 0; i<nodesize; i++)
+	if (new_clique)
+		memcpy(ws->setY_bits, ws->node_set, compat->row_words * sizeof(compat_word));
+
+	index = 0;
+	for (w = 0; w < compat->row_words; w++)
 	{
-		setY[i] = CLIQUE_UNKNOWN;
+		ws->setY_bits[w] &= row[w] & ws->node_set[w];
+		for (bits = ws->setY_bits[w]; bits != 0; bits &= bits - 1)
+		{
+			ws->setY[index] = w * COMPAT_WORD_BITS + lowest_bit(bits);
+			index++;
+		}
 	}
+	ws->setY[index] = CLIQUE_UNKNOWN;
 
-	for (i = 0; i<nodesize; i++)
+	return index;
+}
+
+void leave_Y(struct partition_workspace* ws, const conflict_graph* conflicts, int y)
+{
+	/* Y <- Y - {y}; the nodes y conflicts with have one conflict fewer in Y */
+	const int* list = conflict_list(conflicts, y);
+	int k = CLIQUE_UNKNOWN;
+
+	bits_clear(ws->setY_bits, y);
+	for (k = 0; k < conflict_degree(conflicts, y); k++)
+		ws->conflicts_in_Y[list[k]]--;
+}
+
+int form_setY(struct partition_workspace* ws, const conflict_graph* conflicts, int new_member, int new_clique)
+{
+	/* Y = N minus the conflicts of every member of the current clique.
+	*  new_member has just left N.  A new clique starts Y over from N: the
+	*  conflicts of a member of Y in Y are its conflicts in N (read from the
+	*  degree queue) less those that conflict with new_member too.  After
+	*  that nodes only leave Y, so the counts are updated from their lists
+	*  and the list of Y, which keeps its index order, is only filtered.
+	*/
+	const int* list = conflict_list(conflicts, new_member);
+	int k = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN, w = CLIQUE_UNKNOWN, index = CLIQUE_UNKNOWN, y = CLIQUE_UNKNOWN;
+	compat_word bits = 0;
+
+	index = 0;
+	if (new_clique)
 	{
-		compatibility = CLIQUE_TRUE;
-		if (node_set[i] != CLIQUE_UNKNOWN)
+		memcpy(ws->setY_bits, ws->node_set, ws->row_words * sizeof(compat_word));
+		for (k = 0; k < conflict_degree(conflicts, new_member); k++)
+			bits_clear(ws->setY_bits, list[k]);
+
+		for (w = 0; w < ws->row_words; w++)
 		{
-			for (j = 0; j<nodesize; j++)
+			for (bits = ws->setY_bits[w]; bits != 0; bits &= bits - 1)
 			{
-				if (current_clique[j] != CLIQUE_UNKNOWN)
-				{
-					if (local_compat[current_clique[j]][i] == 0)
-					{
-						compatibility = CLIQUE_FALSE;
-						break;
-					}
-				}
-				else
-					break;
+				y = w * COMPAT_WORD_BITS + lowest_bit(bits);
+				ws->setY[index] = y;
+				index++;
+				ws->conflicts_in_Y[y] = size_of_I_y(ws, conflicts, y);
+			}
+		}
+		for (k = 0; k < conflict_degree(conflicts, new_member); k++)
+		{
+			if (bits_test(ws->node_set, list[k]))
+			{
+				for (j = 0; j < conflict_degree(conflicts, list[k]); j++)
+					ws->conflicts_in_Y[conflict_list(conflicts, list[k])[j]]--;
 			}
-			if (compatibility == CLIQUE_TRUE)
+		}
+	}
+	else
+	{
+		leave_Y(ws, conflicts, new_member);
+		for (k = 0; k < conflict_degree(conflicts, new_member); k++)
+		{
+			if (bits_test(ws->setY_bits, list[k]))
+				leave_Y(ws, conflicts, list[k]);
+		}
+
+		for (k = 0; ws->setY[k] != CLIQUE_UNKNOWN; k++)
+		{
+			if (bits_test(ws->setY_bits, ws->setY[k]))
 			{
-				setY[index] = i;
+				ws->setY[index] = ws->setY[k];
 				index++;
 			}
 		}
 	}
-	setY_size = index;
+	ws->setY[index] = CLIQUE_UNKNOWN;
 
-	return setY_size;
+	return index;
 }
 
 void print_setY(int* setY)
@@ -380,76 +784,134 @@ void print_setY(int* setY)
 	int index = CLIQUE_UNKNOWN;
 
 	index = 0;
-	printf(" setY = {");
+	logPrintf<LOG_TRACE>(" setY = {");
 	while (setY[index] != CLIQUE_UNKNOWN)
 	{
-		printf(" %d ", setY[index]);
+		logPrintf<LOG_TRACE>(" %d ", setY[index]);
 		index++;
 	}
-	printf("}\n");
+	logPrintf<LOG_TRACE>("}\n");
 }
 
-void form_set_Y1(int nodesize, int* set_Y, int* set_Y1, int** sets_I_y, int* node_set)
+int count_I_y_prefix_in_Y(struct partition_workspace* ws, const compat_matrix* compat, int y, int limit)
 {
-	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN, k = CLIQUE_UNKNOWN;
-	int* cards = (int*)NULL;
-	int min_val = CLIQUE_UNKNOWN;
-	int curr_index = CLIQUE_UNKNOWN;
-	int curr_y = CLIQUE_UNKNOWN;
-
-	cards = (int*)malloc(nodesize * sizeof(int));
-
-	for (i = 0; i<nodesize; i++)
+	/* | intersection(first "limit" members of I_y, Y) |  where I_y = N & ~row(y) */
+	const compat_word* row_y = compat_row(compat, y);
+	int w = CLIQUE_UNKNOWN, taken = CLIQUE_UNKNOWN, count = CLIQUE_UNKNOWN, in_word = CLIQUE_UNKNOWN;
+	compat_word I_y = 0, prefix = 0;
+
+	taken = 0;
+	count = 0;
+	for (w = 0; w < compat->row_words && taken < limit; w++)
 	{
-		set_Y1[i] = CLIQUE_UNKNOWN;
-		cards[i] = 0;
+		I_y = ws->node_set[w] & ~row_y[w];
+		in_word = popcount_word(I_y);
+		if (taken + in_word > limit)
+		{
+			/* keep only the lowest (limit - taken) members of this word */
+			prefix = I_y;
+			for (in_word = limit - taken; in_word > 0; in_word--)
+				prefix &= prefix - 1;
+			I_y &= ~prefix;
+			in_word = limit - taken;
+		}
+		count += popcount_word(I_y & ws->setY_bits[w]);
+		taken += in_word;
 	}
+	return count;
+}
 
-	/* Get the cardinalities of  intersection(I_y, setY)
-	for each y in I_y */
-	for (i = 0; i<nodesize; i++) /* for each y in I_y */
+int count_I_y_prefix_in_Y(struct partition_workspace* ws, const conflict_graph* conflicts, int y, int limit)
+{
+	/* the same count from the conflict list of y (I_y = N & conflicts(y)),
+	*  for y in Y.  The list is walked from whichever end reaches the cut
+	*  sooner; members past the first "limit" are counted from the back and
+	*  taken off conflicts_in_Y[y], which holds all of them.
+	*/
+	const int* list = conflict_list(conflicts, y);
+	int k = CLIQUE_UNKNOWN, taken = CLIQUE_UNKNOWN, count = CLIQUE_UNKNOWN;
+	int rest = ws->sizes_of_sets_I_y[y] - limit;
+
+	taken = 0;
+	count = 0;
+	if (limit <= rest)
 	{
-		if (set_Y[i] != CLIQUE_UNKNOWN)
+		for (k = 0; k < conflict_degree(conflicts, y) && taken < limit; k++)
 		{
-			curr_y = set_Y[i];
-
-			for (j = 0; j<nodesize; j++) /* for each node in I_y of curr_y*/
+			if (bits_test(ws->node_set, list[k]))
 			{
-				if (sets_I_y[curr_y][j] != CLIQUE_UNKNOWN)
-				{
-					for (k = 0; k<nodesize; k++) /* for each node in set_Y */
-					{
-						if (set_Y[k] != CLIQUE_UNKNOWN)
-						{
-							if (sets_I_y[i][j] == set_Y[k])
-								cards[i]++;
-						}
-						else
-							break; /* end of set_Y */
-					}
-				}
-				else
-					break;
+				count += bits_test(ws->setY_bits, list[k]);
+				taken++;
 			}
 		}
+		return count;
 	}
 
-	min_val = cards[0];
-	for (i = 0; i<nodesize; i++)
+	for (k = conflict_degree(conflicts, y) - 1; k >= 0 && taken < rest; k--)
 	{
-		if (set_Y[i] != CLIQUE_UNKNOWN)
+		if (bits_test(ws->node_set, list[k]))
 		{
-			if (cards[i] < min_val)
-				min_val = cards[i];
+			count += bits_test(ws->setY_bits, list[k]);
+			taken++;
 		}
 	}
+	return ws->conflicts_in_Y[y] - count;
+}
 
-#ifdef DEBUG
-	printf(" min_val = %d ", min_val);
-#endif
+int count_I_y_in_Y(struct partition_workspace* ws, const compat_matrix* compat, int y, int limit)
+{
+	/* | intersection(first "limit" members of I_y, Y) | */
+	if (limit >= ws->sizes_of_sets_I_y[y])  /* all of I_y; Y is a subset of N */
+		return bits_andnot_popcount(ws->setY_bits, compat_row(compat, y), compat->row_words);
+	return count_I_y_prefix_in_Y(ws, compat, y, limit);
+}
+
+int count_I_y_in_Y(struct partition_workspace* ws, const conflict_graph* conflicts, int y, int limit)
+{
+	if (limit >= ws->sizes_of_sets_I_y[y])  /* all of I_y, kept up to date by form_setY() */
+		return ws->conflicts_in_Y[y];
+	return count_I_y_prefix_in_Y(ws, conflicts, y, limit);
+}
+
+template <class graph>
+void form_set_Y1(struct partition_workspace* ws, const graph* compat, int setY_size, int grain)
+{
+	/* Y1 = { y | y in Y and | intersection(I_y, Y) | = min_val }
+	*
+	*  The cardinalities reproduce the original list based implementation,
+	*  which walked I_(Y[i]) for its length but read the members of I_i, i.e.
+	*  the I set of the node whose id equals the position i in Y (empty when
+	*  node i is not in Y).  That indexing decides which nodes get merged, so
+	*  it is kept to leave the partitions unchanged:
+	*    cards[i] = | intersection(first |I_(Y[i])| members of I_i, Y) |
+	*/
+	int* set_Y = ws->setY;
+	int* set_Y1 = ws->set_Y1;
+	int* cards = ws->cards;
+	int i = CLIQUE_UNKNOWN;
+	int min_val = CLIQUE_UNKNOWN;
+	int curr_index = CLIQUE_UNKNOWN;
+
+	parallelFor(ws->pool, 0, setY_size, grain, [ws, compat](int first, int last) {
+		for (int k = first; k < last; k++)
+		{
+			ws->cards[k] = 0;
+			if (bits_test(ws->setY_bits, k))
+				ws->cards[k] = count_I_y_in_Y(ws, compat, k, ws->sizes_of_sets_I_y[ws->setY[k]]);
+		}
+	});
+
+	min_val = cards[0];
+	for (i = 0; i<setY_size; i++)
+	{
+		if (cards[i] < min_val)
+			min_val = cards[i];
+	}
+
+	logPrintf<LOG_TRACE>(" min_val = %d ", min_val);
 
 	curr_index = 0;
-	for (i = 0; i<nodesize; i++)
+	for (i = 0; i<setY_size; i++)
 	{
 		if (cards[i] == min_val)
 		{
@@ -457,361 +919,450 @@ void form_set_Y1(int nodesize, int* set_Y, int* set_Y1, int** sets_I_y, int* nod
 			curr_index++;
 		}
 	}
+	set_Y1[curr_index] = CLIQUE_UNKNOWN;
+	ws->setY1_size = curr_index;
 
-#ifdef DEBUG
-	printf(" Set Y1 = { ");
-	for (i = 0; i<nodesize; i++)
+	if (logEnabled<LOG_TRACE>())
 	{
-		if (set_Y1[i] != CLIQUE_UNKNOWN)
-			printf(" %d ", set_Y1[i]);
+		logPrintf<LOG_TRACE>(" Set Y1 = { ");
+		for (i = 0; set_Y1[i] != CLIQUE_UNKNOWN; i++)
+		{
+			logPrintf<LOG_TRACE>(" %d ", set_Y1[i]);
+		}
+		logPrintf<LOG_TRACE>(" }\n");
 	}
-	printf(" }\n");
-#endif
 
 	return;
 }
 
-void form_set_Y2(int nodesize, int* set_Y2, int* set_Y1, int* sizes_of_sets_I_y)
+void form_set_Y2(struct partition_workspace* ws)
 {
+	/* Y2 = { y | y in Y1 and |I_y| = max_val } */
+	int* set_Y1 = ws->set_Y1;
+	int* set_Y2 = ws->set_Y2;
+	int* sizes_of_sets_I_y = ws->sizes_of_sets_I_y;
 	int i = CLIQUE_UNKNOWN;
 	int max_val = CLIQUE_UNKNOWN;
 	int curr_index = CLIQUE_UNKNOWN;
 
-	for (i = 0; i<nodesize; i++)
+	for (i = 0; set_Y1[i] != CLIQUE_UNKNOWN; i++)
 	{
-		if (set_Y1[i] != CLIQUE_UNKNOWN)
+		if (sizes_of_sets_I_y[set_Y1[i]] > max_val)
 		{
-
-			if (sizes_of_sets_I_y[set_Y1[i]] > max_val)
-			{
-				max_val = sizes_of_sets_I_y[set_Y1[i]];
-			}
+			max_val = sizes_of_sets_I_y[set_Y1[i]];
 		}
-		else
-			break;
 	}
 
 	curr_index = 0;
-	for (i = 0; i<nodesize; i++)
+	for (i = 0; set_Y1[i] != CLIQUE_UNKNOWN; i++)
 	{
-		if (set_Y1[i] != CLIQUE_UNKNOWN)
+		if (sizes_of_sets_I_y[set_Y1[i]] == max_val)
 		{
-
-			if (sizes_of_sets_I_y[set_Y1[i]] == max_val)
-			{
-				set_Y2[curr_index] = set_Y1[i];
-				curr_index++;
-			}
+			set_Y2[curr_index] = set_Y1[i];
+			curr_index++;
 		}
-		else
-			break;
 	}
+	set_Y2[curr_index] = CLIQUE_UNKNOWN;
 
-#ifdef DEBUG
-	printf(" curr_index = %d   max_val = %d ", curr_index, max_val);
-	printf(" Set Y2 = { ");
-	for (i = 0; i<nodesize; i++)
+	if (logEnabled<LOG_TRACE>())
 	{
-		if (set_Y2[i] != CLIQUE_UNKNOWN)
+		logPrintf<LOG_TRACE>(" curr_index = %d   max_val = %d ", curr_index, max_val);
+		logPrintf<LOG_TRACE>(" Set Y2 = { ");
+		for (i = 0; set_Y2[i] != CLIQUE_UNKNOWN; i++)
 		{
-			printf(" %d ", set_Y2[i]);
+			logPrintf<LOG_TRACE>(" %d ", set_Y2[i]);
 		}
-		else
-			break;
+		logPrintf<LOG_TRACE>(" }\n");
 	}
-	printf(" }\n");
-#endif
 
 	return;
 }
 
-int pick_a_node_to_merge(int* setY, int** local_compat, int* node_set, int nodesize)
+long candidate_cost(const compat_matrix* compat)
 {
-	int** sets_I_y = (int**)NULL;
-	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
-	int* curr_indexes = (int*)NULL;
-	int* set_Y1 = (int*)NULL;
-	int* set_Y2 = (int*)NULL;
-	int* sizes_of_sets_I_y = (int*)NULL;
-	int min_val = CLIQUE_UNKNOWN;
-	int new_node = CLIQUE_UNKNOWN;
-	int curr_node_in_setY = CLIQUE_UNKNOWN;
+	/* words a candidate's |I_y| and cardinality read */
+	return compat->row_words;
+}
 
-	/* dynamically allocate memory for sets_I_y array */
+long candidate_cost(const conflict_graph* conflicts)
+{
+	/* about the list entries they read */
+	return 1 + (long)(conflicts->offsets[conflicts->nodesize] / (conflicts->nodesize + 1));
+}
 
-	sets_I_y = (int**)malloc(nodesize * sizeof(int*));
+template <class graph>
+int candidate_grain(struct partition_workspace* ws, const graph* compat, int setY_size)
+{
+	/* candidates per pool task; all of them (one task, run inline) when
+	*  there is no pool or too little work to pay for the tasks */
+	long cost = candidate_cost(compat);
 
-	for (i = 0; i<nodesize; i++)
-	{
-		sets_I_y[i] = (int*)malloc(nodesize * sizeof(int));
-	}
+	if (ws->pool == NULL || (long)setY_size * cost < CLIQUE_PARALLEL_WORK)
+		return setY_size;
+	return (int)(CLIQUE_TASK_WORK / cost > 1 ? CLIQUE_TASK_WORK / cost : 1);
+}
 
-	curr_indexes = (int*)malloc(nodesize * sizeof(int));
-	sizes_of_sets_I_y = (int*)malloc(nodesize * sizeof(int));
+template <class graph>
+int pick_a_node_to_merge(struct partition_workspace* ws, const graph* compat, int setY_size)
+{
+	int i = CLIQUE_UNKNOWN;
+	int new_node = CLIQUE_UNKNOWN;
+	int curr_node_in_setY = CLIQUE_UNKNOWN;
+	int grain = candidate_grain(ws, compat, setY_size);
 
-	for (i = 0; i<nodesize; i++)
+	/* |I_y| for each y in Y */
+	parallelFor(ws->pool, 0, setY_size, grain, [ws, compat](int first, int last) {
+		for (int k = first; k < last; k++)
+			ws->sizes_of_sets_I_y[ws->setY[k]] = size_of_I_y(ws, compat, ws->setY[k]);
+	});
+
+	if (logEnabled<LOG_TRACE>())
 	{
-		curr_indexes[i] = 0;
-		sizes_of_sets_I_y[i] = 0;
-		for (j = 0; j<nodesize; j++)
+		for (i = 0; i<setY_size; i++)
 		{
-			sets_I_y[i][j] = CLIQUE_UNKNOWN;
+			curr_node_in_setY = ws->setY[i];
+			logPrintf<LOG_TRACE>(" i= %d  nodeno= %d, |I_y| = %d\n", i, curr_node_in_setY, ws->sizes_of_sets_I_y[curr_node_in_setY]);
 		}
 	}
 
-	/* form I_y sets */
+	form_set_Y1(ws, compat, setY_size, grain);
+	form_set_Y2(ws);
 
-	for (i = 0; i<nodesize; i++)
+	/* Y2 is in index order, so for seed 0 this is its first node */
+	for (i = 0; ws->set_Y2[i] != CLIQUE_UNKNOWN; i++)
 	{
-		if (setY[i] != CLIQUE_UNKNOWN) /* for each y in Y do */
-		{
-			for (j = 0; j<nodesize; j++)
-			{
-				if (node_set[j] != CLIQUE_UNKNOWN)
-				{  /* if this node is still in set N */
-					if (local_compat[setY[i]][j] != 1)
-					{
-						sets_I_y[setY[i]][curr_indexes[setY[i]]] = j;
-						curr_indexes[setY[i]]++;
-					}
-				}
-			}
-		}
-		else
-			break;  /* end of setY */
+		if (new_node == CLIQUE_UNKNOWN || tie_rank(ws->seed, ws->set_Y2[i]) < tie_rank(ws->seed, new_node))
+			new_node = ws->set_Y2[i];
 	}
 
-	for (i = 0; i<nodesize; i++)
-	{
-		if (setY[i] != CLIQUE_UNKNOWN) /* for each y in Y do */
-		{
-			curr_node_in_setY = setY[i];
+	return new_node;
+}
+
+void init_clique_set(struct clique_result* result, int nodesize, synth_arena* arena)
+{
+	result->num_cliques = 0;
+	result->nodesize = nodesize;
+	result->arena = arena;
+	result->offsets = (int*)arena_alloc(arena, (nodesize + 1) * sizeof(int));
+	result->members = (int*)arena_alloc(arena, (nodesize + 1) * sizeof(int));
+	result->offsets[0] = 0;
+	memset(&result->stats, 0, sizeof(result->stats));
+	result->stats.nodes = nodesize;
+	result->stats.starts = 1;
+}
 
-			/* copy curr index into sizes */
-			sizes_of_sets_I_y[curr_node_in_setY] = curr_indexes[curr_node_in_setY];
+void print_clique_set(const struct clique_result* result)
+{
+	int i = UNKNOWN, j = UNKNOWN;
 
-			/* print all I_y sets */
+	if (!logEnabled<LOG_DEBUG>())
+		return;
+	logPrintf<LOG_DEBUG>("\n Clique Set: \n");
 
-#ifdef DEBUG
-			printf(" i= %d  nodeno= %d, curr_index = %d  ", i, curr_node_in_setY, curr_indexes[curr_node_in_setY]);
+	for (i = 0; i<result->num_cliques; i++)
+	{
+		logPrintf<LOG_DEBUG>("\tClique #%d (size = %d) = { ", i, clique_size(result, i));
 
-			print_setY(sets_I_y[curr_node_in_setY]);
-#endif
+		for (j = 0; j<clique_size(result, i); j++)
+		{
+			logPrintf<LOG_DEBUG>(" %d ", clique_members(result, i)[j]);
 		}
+		logPrintf<LOG_DEBUG>(" }\n");
 	}
-
-	/* form set_Y1 */
-	set_Y1 = (int*)malloc(nodesize * sizeof(int));
-	for (i = 0; i<nodesize; i++) { set_Y1[i] = CLIQUE_UNKNOWN; }
-	form_set_Y1(nodesize, setY, set_Y1, sets_I_y, node_set);
-
-	/* form set_Y2 */
-	set_Y2 = (int*)malloc(nodesize * sizeof(int));
-	for (i = 0; i<nodesize; i++) { set_Y2[i] = CLIQUE_UNKNOWN; }
-	form_set_Y2(nodesize, set_Y2, set_Y1, sizes_of_sets_I_y);
-
-	if (set_Y2[0] != CLIQUE_UNKNOWN)
-		new_node = set_Y2[0];
-
-	return new_node;
+	logPrintf<LOG_DEBUG>("\n");
 }
 
-void init_clique_set()
+
+void print_graph(const compat_matrix* compat)
 {
-	int i = UNKNOWN, j = UNKNOWN;
-	//printf("\n Initializing the clique set..");
+	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
+	string row;
 
-	for (i = 0; i<MAXCLIQUES; i++)
+	logPrintf<LOG_TRACE>(" You entered the compatibility array: \n");
+	for (i = 0; i<compat->nodesize; i++)
 	{
-		clique_set[i].size = UNKNOWN;
-		for (j = 0; j<MAXCLIQUES; j++)
+		row = "\t";
+		for (j = 0; j<compat->nodesize; j++)
 		{
-			clique_set[i].members[j] = UNKNOWN;
+			row += compat_test(compat, i, j) ? "1 " : "0 ";
 		}
+		logPrintf<LOG_TRACE>("%s\n", row.c_str());
 	}
-	//printf("..Done.\n");
 }
 
-void print_clique_set()
+void print_graph(const conflict_graph* conflicts)
 {
-	int i = UNKNOWN, j = UNKNOWN;
-
-	printf("\n Clique Set: \n");
+	int i = CLIQUE_UNKNOWN, k = CLIQUE_UNKNOWN;
+	string row;
 
-	for (i = 0; i<MAXCLIQUES; i++)
+	logPrintf<LOG_TRACE>(" You entered the conflict lists: \n");
+	for (i = 0; i<conflicts->nodesize; i++)
 	{
-		if (clique_set[i].size == UNKNOWN) break;
-
-		printf("\tClique #%d (size = %d) = { ", i, clique_set[i].size);
-
-		for (j = 0; j<MAXCLIQUES; j++)
+		row = "\t" + to_string(i) + ":";
+		for (k = 0; k<conflict_degree(conflicts, i); k++)
 		{
-			if (clique_set[i].members[j] != UNKNOWN)
-				printf(" %d ", clique_set[i].members[j]);
-			else
-				break;
+			row += " " + to_string(conflict_list(conflicts, i)[k]);
 		}
-		printf(" }\n");
+		logPrintf<LOG_TRACE>("%s\n", row.c_str());
 	}
-	printf("\n");
 }
 
-
-int clique_partition(int** compat, int nodesize)
+/* the heuristic itself, for a compat_matrix or a conflict_graph; the
+*  result and the workspace come from arena.  Returns 0, with nothing
+*  left allocated, if a deadline is given and passes first. */
+template <class graph>
+int partition_graph(const graph* compat, struct clique_result* result, workStealingPool* pool,
+	unsigned long seed, synth_arena* arena, const chrono::steady_clock::time_point* deadline)
 {
-	int** local_compat = (int**)NULL;
+	int nodesize = compat->nodesize;
+	struct partition_workspace ws;
 	int* current_clique = (int*)NULL;
-	int* node_set = (int*)NULL;
-	int* setY = (int*)NULL;
-	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
+	int i = CLIQUE_UNKNOWN;
 	int node_x = CLIQUE_UNKNOWN, node_y = CLIQUE_UNKNOWN;
 	int setY_cardinality = CLIQUE_UNKNOWN;
-	int new_node = CLIQUE_UNKNOWN;
 	int curr_index = CLIQUE_UNKNOWN;
 	int size_N = CLIQUE_UNKNOWN;
-	int clique_index = CLIQUE_UNKNOWN;
-	/*int nodesize=CLIQUE_UNKNOWN;*/
+	int member_index = CLIQUE_UNKNOWN;
+	long steps = 0;
 
-	printf("\n");
-	printf("**************************************\n");
-	printf(" *       Clique Partitioner         *\n");
-	printf("**************************************\n");
-	printf("\nEntering Clique Partitioner.. \n");
+	logPrintf<LOG_DEBUG>("\n");
+	logPrintf<LOG_DEBUG>("**************************************\n");
+	logPrintf<LOG_DEBUG>(" *       Clique Partitioner         *\n");
+	logPrintf<LOG_DEBUG>("**************************************\n");
+	logPrintf<LOG_DEBUG>("\nEntering Clique Partitioner.. \n");
 
-	input_sanity_check(compat, nodesize);
+	input_sanity_check(compat);
 
-	/* dynamically allocate memory for local copy */
+	if (logEnabled<LOG_TRACE>())
+		print_graph(compat);
 
-	local_compat = (int**)malloc(nodesize * sizeof(int*));
+	init_clique_set(result, nodesize, arena);
 
-	for (i = 0; i<nodesize; i++)
-	{
-		local_compat[i] = (int*)malloc(nodesize * sizeof(int));
-	}
-
-	make_a_local_copy(local_compat, compat, nodesize);
-
-	printf(" You entered the compatibility array: \n");
-	for (i = 0; i<nodesize; i++)
-	{
-		printf("\t");
-		for (j = 0; j<nodesize; j++)
-		{
-			printf("%d ", local_compat[i][j]);
-		}
-		printf("\n");
-	}
-
-	init_clique_set();
-
-	/* allocate memory for current clique & initialize to unknown values*/
+	/* allocate the workspace; current clique is initialized to unknown values */
 	/* - current_clique has the indices of nodes that are compatible with each other*/
-	/* - A node i is in node_set if node_set[i] = i */
-
-	current_clique = (int*)malloc(nodesize * sizeof(int));
-	node_set = (int*)malloc(nodesize * sizeof(int));
-	setY = (int*)malloc(nodesize * sizeof(int));
+	/* - A node i is in N if bit i of node_set is set */
 
-	for (i = 0; i<nodesize; i++)
-	{
-		current_clique[i] = CLIQUE_UNKNOWN;
-		node_set[i] = i;
-		setY[i] = CLIQUE_UNKNOWN;
-	}
+	workspace_init(&ws, nodesize, compat_row_words(nodesize), arena);
+	degree_queue_init(&ws.degrees, compat, ws.node_set, arena);
+	ws.pool = pool;
+	ws.seed = seed;
+	current_clique = ws.current_clique;
 
 	size_N = nodesize;
 	curr_index = 0; /* reset the index to start for current clique */
 
 	while (size_N > 0) /* i.e still cliques to be formed */
 	{
+		if (deadline != NULL && (++steps & 63) == 0 && chrono::steady_clock::now() > *deadline)
+		{
+			workspace_free(&ws);
+			clique_result_free(result);
+			return 0;
+		}
 
-#ifdef DEBUG
-		printf("=====================================================\n");
-		printf(" size_N = %d  node_set = { ", size_N);
-		for (i = 0; i<nodesize; i++) {
-			printf(" %d ", node_set[i]);
+		if (logEnabled<LOG_TRACE>())
+		{
+			logPrintf<LOG_TRACE>("=====================================================\n");
+			logPrintf<LOG_TRACE>(" size_N = %d  node_set = { ", size_N);
+			for (i = 0; i<nodesize; i++) {
+				logPrintf<LOG_TRACE>(" %d ", bits_test(ws.node_set, i) ? i : CLIQUE_UNKNOWN);
+			}
+			logPrintf<LOG_TRACE>(" }\n");
 		}
-		printf(" }\n");
-#endif
 
 		if (current_clique[0] == CLIQUE_UNKNOWN)  /* new clique formation */
 		{
-			node_x = select_new_node(local_compat, nodesize, node_set);
-#ifdef DEBUG
-			printf(" Node x = %d\n", node_x);   /* first node in the clique */
-#endif
+			node_x = select_new_node(&ws.degrees, ws.seed);
+			logPrintf<LOG_TRACE>(" Node x = %d\n", node_x);   /* first node in the clique */
 			current_clique[curr_index] = node_x;
-			node_set[node_x] = CLIQUE_UNKNOWN;   /* remove node_x from N i.e node_set */
+			remove_node_from_N(node_x, compat, ws.node_set, &ws.degrees);   /* remove node_x from N i.e node_set */
 			curr_index++;
 		}
 
 		setY_cardinality = CLIQUE_UNKNOWN;
-		setY_cardinality = form_setY(setY, current_clique, local_compat,
-			nodesize, node_set);
-#ifdef DEBUG
-		print_setY(setY);
-		printf(" Set Y cardinality = %d \n", setY_cardinality);
-#endif
+		setY_cardinality = form_setY(&ws, compat, current_clique[curr_index - 1], curr_index == 1);
+		if (logEnabled<LOG_TRACE>())
+		{
+			print_setY(ws.setY);
+			logPrintf<LOG_TRACE>(" Set Y cardinality = %d \n", setY_cardinality);
+		}
 
 
 		if (setY_cardinality == 0) /* No possible nodes for merger; declare current_cliqueas complete */
-		{   //printf("completing clique!\n");
-			/* copy the current clique into central datastructure */
-			clique_index = 0;
-			while (clique_set[clique_index].size != UNKNOWN)
-			{
-				clique_index++;
-				//printf("index = %d\n",clique_index );
-
-			}
-			//printf("index = %d size = %d\n",clique_index, clique_set[clique_index].size );
-			clique_set[clique_index].size = 0;
-
-			//printf(" A clique is found!! Clique = { ");
+		{
+			/* append the current clique to the results */
+			member_index = result->offsets[result->num_cliques];
 
-			for (i = 0; i< nodesize; i++)
+			for (i = 0; i< curr_index; i++)
 			{
-				//printf("node_index = %d\n",i );
-				if (current_clique[i] != CLIQUE_UNKNOWN)
-				{
-					clique_set[clique_index].members[i] = current_clique[i];
+				result->members[member_index] = current_clique[i];
+				member_index++;
 
-					//printf(" %d ", current_clique[i]);
-
-
-
-					node_set[current_clique[i]] = CLIQUE_UNKNOWN; /* remove this node from the node list */
-					current_clique[i] = CLIQUE_UNKNOWN;
-					size_N = (size_N - 1);
-					(clique_set[clique_index].size)++;
-				}
-				else
-				{
-					break;
-				}
+				/* already removed from N when it joined the clique */
+				current_clique[i] = CLIQUE_UNKNOWN;
+				size_N = (size_N - 1);
 			}
-			//printf(" }\n");
+			result->num_cliques++;
+			result->offsets[result->num_cliques] = member_index;
+			result->stats.cliques++;
 			curr_index = 0; /* reset the curr_index for the next clique */
 		}
 		else
 		{
-			node_y = pick_a_node_to_merge(setY, local_compat, node_set, nodesize);
+			node_y = pick_a_node_to_merge(&ws, compat, setY_cardinality);
+			result->stats.merge_steps++;
+			result->stats.candidate_evaluations += setY_cardinality;
+			if (setY_cardinality > result->stats.max_setY)
+				result->stats.max_setY = setY_cardinality;
+			result->stats.tied_candidates += ws.setY1_size;
 			current_clique[curr_index] = node_y;
-			node_set[node_y] = CLIQUE_UNKNOWN;
-#ifdef DEBUG
-			printf(" y (new node) = %d \n", node_y);
-#endif
+			remove_node_from_N(node_y, compat, ws.node_set, &ws.degrees);
+			logPrintf<LOG_TRACE>(" y (new node) = %d \n", node_y);
 			curr_index++;
 		}
 	}
-	output_sanity_check(nodesize, local_compat, compat);
-	printf("\n Final Clique Partitioning Results:\n");
-	print_clique_set();
-	printf("Exiting Clique Partitioner.. Bye.\n");
-	printf("**************************************\n\n");
+	output_sanity_check(compat, result);
+	logPrintf<LOG_DEBUG>("\n Final Clique Partitioning Results:\n");
+	print_clique_set(result);
+	logPrintf<LOG_DEBUG>("Exiting Clique Partitioner.. Bye.\n");
+	logPrintf<LOG_DEBUG>("**************************************\n\n");
+
+	workspace_free(&ws);
+	return 1;
+}
+
+long clique_mux_inputs(const struct clique_result* result)
+{
+	/* one multiplexer input per member of every clique with two or more */
+	long inputs = 0;
+	int k = CLIQUE_UNKNOWN;
+
+	for (k = 0; k < result->num_cliques; k++)
+	{
+		if (clique_size(result, k) > 1)
+			inputs += clique_size(result, k);
+	}
+	return inputs;
+}
+
+int better_partition(const struct clique_result* a, const struct clique_result* b, enum clique_goal goal)
+{
+	/* 1 if a beats b; equal partitions keep the earlier start */
+	long cliques_a = a->num_cliques, cliques_b = b->num_cliques;
+	long inputs_a = clique_mux_inputs(a), inputs_b = clique_mux_inputs(b);
+
+	if (goal == CLIQUE_FEWEST_MUX_INPUTS)
+		return inputs_a < inputs_b || (inputs_a == inputs_b && cliques_a < cliques_b);
+	return cliques_a < cliques_b || (cliques_a == cliques_b && inputs_a < inputs_b);
+}
+
+/********************************************************************************
+*  Multi-start search
+*
+*  Start 0 is the plain heuristic in the graph's arena and always finishes.
+*  Starts 1 .. starts-1 break ties with seed + k, each in its own heap-backed
+*  workspace (the arena is not shared between threads), and run as tasks on
+*  the pool when there is one.  Once budget_ms has passed, starts not yet
+*  begun are skipped and those running give up at their next check.  The
+*  best finished partition (in start order on equal cost) is kept.
+********************************************************************************/
+
+template <class graph>
+int search_partitions(const graph* compat, struct clique_result* result, workStealingPool* pool, const struct clique_search* search)
+{
+	int starts = search->starts;
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() +
+		chrono::microseconds((long long)(search->budget_ms * 1000));
+	const chrono::steady_clock::time_point* limit = search->budget_ms > 0 ? &deadline : (const chrono::steady_clock::time_point*)NULL;
+	struct clique_result* tries = (struct clique_result*)calloc(starts, sizeof(struct clique_result));
+	int* finished = (int*)calloc(starts, sizeof(int));
+	int best = 0, k = CLIQUE_UNKNOWN;
+	long completed = 0;
+
+	if (tries == NULL || finished == NULL)
+	{
+		logPrintf<LOG_ERROR>("Out of memory allocating %d clique partitioner starts. Aborting..\n", starts);
+		exit(0);
+	}
+
+	parallelFor(pool, 0, starts, 1, [&](int first, int last) {
+		for (int s = first; s < last; s++)
+		{
+			if (s == 0)
+				finished[s] = partition_graph(compat, &tries[s], pool, 0, compat->arena, (const chrono::steady_clock::time_point*)NULL);
+			else if (limit == NULL || chrono::steady_clock::now() < deadline)
+				finished[s] = partition_graph(compat, &tries[s], pool, search->seed + s, (synth_arena*)NULL, limit);
+		}
+	});
+
+	for (k = 0; k < starts; k++)
+	{
+		if (!finished[k])
+			continue;
+		completed++;
+		logPrintf<LOG_DEBUG>(" start %d: %d cliques, %ld mux inputs\n", k, tries[k].num_cliques, clique_mux_inputs(&tries[k]));
+		if (k != best && better_partition(&tries[k], &tries[best], search->goal))
+			best = k;
+	}
+	for (k = 0; k < starts; k++)
+	{
+		if (finished[k] && k != best)
+			clique_result_free(&tries[k]);
+	}
+
+	*result = tries[best];
+	result->stats.starts = completed;
+	result->stats.best_start = best;
+	free(tries);
+	free(finished);
 	return 1;
 }
 
+int clique_partition(const compat_matrix* compat, struct clique_result* result, workStealingPool* pool = (workStealingPool*)NULL,
+	const struct clique_search* search = (const struct clique_search*)NULL)
+{
+	if (search != NULL && search->starts > 1)
+		return search_partitions(compat, result, pool, search);
+	return partition_graph(compat, result, pool, 0, compat->arena, (const chrono::steady_clock::time_point*)NULL);
+}
+
+int clique_partition(const conflict_graph* conflicts, struct clique_result* result, workStealingPool* pool = (workStealingPool*)NULL,
+	const struct clique_search* search = (const struct clique_search*)NULL)
+{
+	if (search != NULL && search->starts > 1)
+		return search_partitions(conflicts, result, pool, search);
+	return partition_graph(conflicts, result, pool, 0, conflicts->arena, (const chrono::steady_clock::time_point*)NULL);
+}
+
+int clique_partition(int** compat, int nodesize, struct clique_result* result)
+{
+	/* packs a two dimensional 0/1 array and partitions it;
+	*  the result is allocated on the heap */
+	compat_matrix packed;
+	int i = CLIQUE_UNKNOWN, j = CLIQUE_UNKNOWN;
+	int status = CLIQUE_UNKNOWN;
+
+	compat_matrix_init(&packed, nodesize, (synth_arena*)NULL);
+	for (i = 0; i<nodesize; i++)
+	{
+		for (j = 0; j<nodesize; j++)
+		{
+			if ((compat[i][j] != 1) && (compat[i][j] != 0))
+			{
+				logPrintf<LOG_ERROR>(" %d \n", compat[i][j]);
+				logPrintf<LOG_ERROR>("The value of an array element is other than 1 or 0. Aborting..\n");
+				exit(0);
+			}
+			if (compat[i][j] == 1)
+				compat_set(&packed, i, j);
+		}
+	}
+
+	status = clique_partition(&packed, result);
+	compat_matrix_free(&packed);
+	return status;
+}
+
 // int main()
 // {
 // int** compat;
@@ -871,30 +1422,25 @@ int clique_partition(int** compat, int nodesize)
 // compat[8][6]=0;     compat[8][7]=0;    compat[8][8]=1;  
 
 
-// clique_partition(compat, 9);
+// struct clique_result result;
+// clique_partition(compat, 9, &result);
 
 // /** The following is prototype code that illustrates
 // how to access the clique partitioning results.
 // You can modify this according to your needs.
 
-// for(i=0; i<MAXCLIQUES; i++)
+// for(i=0; i<result.num_cliques; i++)
 // {
-// if(clique_set[i].size == UNKNOWN) break;
-
-// printf(" Clique #%d (size = %d) = { ",i, clique_set[i].size);
+// printf(" Clique #%d (size = %d) = { ",i, clique_size(&result, i));
 
-// for(j=0; j<MAXCLIQUES; j++)
+// for(j=0; j<clique_size(&result, i); j++)
 // {
-// if(clique_set[i].members[j] != UNKNOWN)
-// printf(" %d ", clique_set[i].members[j]);
-// else
-// break;
+// printf(" %d ", clique_members(&result, i)[j]);
 // }
 // printf (" }\n");
 // }
+// clique_result_free(&result);
 // **/ 
 // }
 
-
-
-
+#endif
@@ -0,0 +1,175 @@
+#ifndef COMPAT_BUILDER_HPP
+#define COMPAT_BUILDER_HPP
+
+#include <limits.h>
+#include <vector>
+#include "compat_matrix.h"
+#include "thread_pool.hpp"
+
+using namespace std;
+
+//Parallel builder for symmetric compatibility matrices.
+//
+//The matrix is cut into 64 x 64 tiles, one word per row each. Only tiles on
+//or above the diagonal are computed; every tile above the diagonal is then
+//bit-transposed into its mirror below it. A task owns a 64-row block and
+//writes its own upper tiles plus the transposed tiles, which sit in other
+//rows but in the column word of its own block, so no two tasks ever write
+//the same word. Blocks are handed out in pairs from both ends of the
+//diagonal so every task gets the same amount of upper triangle.
+//
+//A kernel fills one tile word: bit k of word w of row i is the test of
+//node i against node 64 w + k. The kernels below compare 8 nodes per
+//instruction with AVX2 when the CPU has it. Their arrays are padded to a
+//whole number of words with values that fail the test, so bits past the
+//last node stay zero.
+
+//64 x 64 bit transpose in place: bit c of a[r] moves to bit r of a[c]
+inline void transpose_tile(compat_word a[64])
+{
+	compat_word m = 0x00000000FFFFFFFFULL, t;
+
+	for (int j = 32; j != 0; j >>= 1, m ^= m << j)
+		for (int k = 0; k < 64; k = ((k | j) + 1) & ~j)
+		{
+			t = ((a[k] >> j) ^ a[k | j]) & m;
+			a[k] ^= t << j;
+			a[k | j] ^= t;
+		}
+}
+
+template <class Kernel>
+void buildSymmetricMatrix(compat_matrix* m, const Kernel& kernel, workStealingPool* pool)
+{
+	int n = m->nodesize;
+	int blocks = (n + COMPAT_WORD_BITS - 1) / COMPAT_WORD_BITS;
+
+	auto fillBlock = [m, n, blocks, &kernel](int b) {
+		int firstRow = b * COMPAT_WORD_BITS;
+		int rows = min(COMPAT_WORD_BITS, n - firstRow);
+		compat_word tile[COMPAT_WORD_BITS];
+
+		for (int w = b; w < blocks; w++)
+		{
+			for (int r = 0; r < COMPAT_WORD_BITS; r++)
+				tile[r] = (r < rows) ? kernel(firstRow + r, w) : 0;
+			for (int r = 0; r < rows; r++)
+				compat_row(m, firstRow + r)[w] = tile[r];
+
+			if (w == b)
+				continue; //the diagonal tile is already complete
+
+			transpose_tile(tile);
+			int mirrorRows = min(COMPAT_WORD_BITS, n - w * COMPAT_WORD_BITS);
+			for (int r = 0; r < mirrorRows; r++)
+				compat_row(m, w * COMPAT_WORD_BITS + r)[b] = tile[r];
+		}
+
+		for (int r = 0; r < rows; r++) //every node is compatible with itself
+			compat_set(m, firstRow + r, firstRow + r);
+	};
+
+	int pairs = (blocks + 1) / 2;
+	int grain = max(1, 64 / max(blocks, 1)); //a few thousand tile words per task
+	parallelFor(pool, 0, pairs, grain, [&fillBlock, blocks](int first, int last) {
+		for (int p = first; p < last; p++)
+		{
+			fillBlock(p);
+			if (blocks - 1 - p != p)
+				fillBlock(blocks - 1 - p);
+		}
+	});
+}
+
+inline int padded_nodes(int n)
+{
+	return (n + COMPAT_WORD_BITS - 1) / COMPAT_WORD_BITS * COMPAT_WORD_BITS;
+}
+
+//FU graph: same type, different timestep
+struct sameTypeOtherStepKernel {
+	vector<int> type, step; //padded with type -1
+
+	sameTypeOtherStepKernel(int n) : type(padded_nodes(n), -1), step(padded_nodes(n), 0) {}
+
+	compat_word scalar(int i, int w) const
+	{
+		compat_word bits = 0;
+		const int* t = &type[w * COMPAT_WORD_BITS];
+		const int* s = &step[w * COMPAT_WORD_BITS];
+		for (int k = 0; k < COMPAT_WORD_BITS; k++)
+			bits |= (compat_word)((t[k] == type[i]) & (s[k] != step[i])) << k;
+		return bits;
+	}
+
+#ifdef COMPAT_HAVE_AVX2_PATH
+	COMPAT_AVX2_TARGET compat_word avx2(int i, int w) const
+	{
+		compat_word bits = 0;
+		__m256i ti = _mm256_set1_epi32(type[i]), si = _mm256_set1_epi32(step[i]);
+		for (int k = 0; k < COMPAT_WORD_BITS; k += 8)
+		{
+			__m256i t = _mm256_loadu_si256((const __m256i*)&type[w * COMPAT_WORD_BITS + k]);
+			__m256i s = _mm256_loadu_si256((const __m256i*)&step[w * COMPAT_WORD_BITS + k]);
+			__m256i ok = _mm256_andnot_si256(_mm256_cmpeq_epi32(s, si), _mm256_cmpeq_epi32(t, ti));
+			bits |= (compat_word)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(ok)) << k;
+		}
+		return bits;
+	}
+#endif
+
+	compat_word operator()(int i, int w) const
+	{
+#ifdef COMPAT_HAVE_AVX2_PATH
+		if (cpu_has_avx2())
+			return avx2(i, w);
+#endif
+		return scalar(i, w);
+	}
+};
+
+//register graph: lifetimes do not overlap (j starts when or after i ends,
+//or ends when or before i starts)
+struct disjointLifetimeKernel {
+	vector<int> first, last; //padded so neither test can hold
+
+	disjointLifetimeKernel(int n) : first(padded_nodes(n), INT_MIN), last(padded_nodes(n), INT_MAX) {}
+
+	compat_word scalar(int i, int w) const
+	{
+		compat_word bits = 0;
+		const int* f = &first[w * COMPAT_WORD_BITS];
+		const int* l = &last[w * COMPAT_WORD_BITS];
+		for (int k = 0; k < COMPAT_WORD_BITS; k++)
+			bits |= (compat_word)((last[i] <= f[k]) | (first[i] >= l[k])) << k;
+		return bits;
+	}
+
+#ifdef COMPAT_HAVE_AVX2_PATH
+	COMPAT_AVX2_TARGET compat_word avx2(int i, int w) const
+	{
+		compat_word bits = 0;
+		__m256i fi = _mm256_set1_epi32(first[i]), li = _mm256_set1_epi32(last[i]);
+		for (int k = 0; k < COMPAT_WORD_BITS; k += 8)
+		{
+			__m256i f = _mm256_loadu_si256((const __m256i*)&first[w * COMPAT_WORD_BITS + k]);
+			__m256i l = _mm256_loadu_si256((const __m256i*)&last[w * COMPAT_WORD_BITS + k]);
+			//last[i] <= f  is  !(last[i] > f);  first[i] >= l  is  !(l > first[i])
+			__m256i overlap = _mm256_and_si256(_mm256_cmpgt_epi32(li, f), _mm256_cmpgt_epi32(l, fi));
+			bits |= (compat_word)(~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(overlap)) & 0xFFu) << k;
+		}
+		return bits;
+	}
+#endif
+
+	compat_word operator()(int i, int w) const
+	{
+#ifdef COMPAT_HAVE_AVX2_PATH
+		if (cpu_has_avx2())
+			return avx2(i, w);
+#endif
+		return scalar(i, w);
+	}
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef COMPAT_MATRIX_H
+#define COMPAT_MATRIX_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "synth_arena.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if (defined(__GNUC__) && defined(__x86_64__)) || (defined(_M_X64) && defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+/****************************************************************************
+*  Bit-packed compatibility matrix used by the clique partitioner.
+*
+*   o One bit per edge: bit j of row i is set iff nodes i and j are compatible.
+*   o Every row is padded to a whole number of 64-byte cache lines and the
+*     matrix itself is cache-line aligned, so rows can be streamed with
+*     aligned 256-bit loads.
+*   o Padding bits are always zero; kernels may run over full rows.
+*
+*   The set kernels below (AND, AND-NOT, popcount) operate on "row_words"
+*   long bitsets and are shared by the matrix rows and the partitioner's
+*   node sets.  An AVX2 popcount is used when the CPU supports it.
+****************************************************************************/
+
+#define COMPAT_WORD_BITS 64
+#define COMPAT_LINE_WORDS 8   /* 64-bit words per 64-byte cache line */
+
+typedef uint64_t compat_word;
+
+struct compat_matrix
+{
+	int nodesize;               /* number of nodes (rows) */
+	int row_words;              /* words per row, multiple of COMPAT_LINE_WORDS */
+	compat_word* bits;          /* nodesize * row_words words, 64-byte aligned */
+	synth_arena* arena;         /* where bits (and the partitioner's scratch) come from */
+};
+
+inline int compat_row_words(int nodesize)
+{
+	int words = (nodesize + COMPAT_WORD_BITS - 1) / COMPAT_WORD_BITS;
+	return ((words + COMPAT_LINE_WORDS - 1) / COMPAT_LINE_WORDS) * COMPAT_LINE_WORDS;
+}
+
+/* zeroed, 64-byte aligned bitset storage from the run arena (NULL: heap) */
+inline compat_word* compat_alloc_words(synth_arena* arena, size_t words)
+{
+	compat_word* p = (compat_word*)arena_alloc(arena, words * sizeof(compat_word));
+	memset(p, 0, words * sizeof(compat_word));
+	return p;
+}
+
+inline void compat_free_words(synth_arena* arena, compat_word* p, size_t words)
+{
+	arena_free(arena, p, words * sizeof(compat_word));
+}
+
+inline void compat_matrix_init(compat_matrix* m, int nodesize, synth_arena* arena)
+{
+	m->nodesize = nodesize;
+	m->row_words = compat_row_words(nodesize);
+	m->arena = arena;
+	m->bits = compat_alloc_words(arena, (size_t)nodesize * m->row_words);
+}
+
+inline void compat_matrix_free(compat_matrix* m)
+{
+	compat_free_words(m->arena, m->bits, (size_t)m->nodesize * m->row_words);
+	m->bits = NULL;
+	m->nodesize = 0;
+	m->row_words = 0;
+}
+
+inline compat_word* compat_row(const compat_matrix* m, int i)
+{
+	return m->bits + (size_t)i * m->row_words;
+}
+
+inline int compat_test(const compat_matrix* m, int i, int j)
+{
+	return (int)((compat_row(m, i)[j / COMPAT_WORD_BITS] >> (j % COMPAT_WORD_BITS)) & 1);
+}
+
+inline void compat_set(compat_matrix* m, int i, int j)
+{
+	compat_row(m, i)[j / COMPAT_WORD_BITS] |= (compat_word)1 << (j % COMPAT_WORD_BITS);
+}
+
+inline void compat_clear(compat_matrix* m, int i, int j)
+{
+	compat_row(m, i)[j / COMPAT_WORD_BITS] &= ~((compat_word)1 << (j % COMPAT_WORD_BITS));
+}
+
+/* single-bit helpers for bitsets laid out like a matrix row */
+
+inline int bits_test(const compat_word* s, int i)
+{
+	return (int)((s[i / COMPAT_WORD_BITS] >> (i % COMPAT_WORD_BITS)) & 1);
+}
+
+inline void bits_set(compat_word* s, int i)
+{
+	s[i / COMPAT_WORD_BITS] |= (compat_word)1 << (i % COMPAT_WORD_BITS);
+}
+
+inline void bits_clear(compat_word* s, int i)
+{
+	s[i / COMPAT_WORD_BITS] &= ~((compat_word)1 << (i % COMPAT_WORD_BITS));
+}
+
+inline int popcount_word(compat_word w)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(w);
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* index of the lowest set bit, w != 0 */
+inline int lowest_bit(compat_word w)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long idx;
+	_BitScanForward64(&idx, w);
+	return (int)idx;
+#else
+	int n = 0;
+	while (!(w & 1)) { w >>= 1; n++; }
+	return n;
+#endif
+}
+
+/****************************************************************************
+*  Word-wide kernels.  "words" is always a multiple of COMPAT_LINE_WORDS and
+*  the pointers are 64-byte aligned (matrix rows or compat_alloc_words()).
+****************************************************************************/
+
+inline int bits_and_popcount_scalar(const compat_word* a, const compat_word* b, int words)
+{
+	int count = 0;
+	for (int w = 0; w < words; w++)
+		count += popcount_word(a[w] & b[w]);
+	return count;
+}
+
+inline int bits_andnot_popcount_scalar(const compat_word* a, const compat_word* not_b, int words)
+{
+	int count = 0;
+	for (int w = 0; w < words; w++)
+		count += popcount_word(a[w] & ~not_b[w]);
+	return count;
+}
+
+#if (defined(__GNUC__) && defined(__x86_64__)) || (defined(_M_X64) && defined(__AVX2__))
+#define COMPAT_HAVE_AVX2_PATH 1
+
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define COMPAT_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define COMPAT_AVX2_TARGET
+#endif
+
+/* nibble-lookup popcount of a 256-bit vector, summed into four 64-bit lanes */
+COMPAT_AVX2_TARGET inline __m256i popcount_avx2_lanes(__m256i v)
+{
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low_mask = _mm256_set1_epi8(0x0f);
+	__m256i lo = _mm256_and_si256(v, low_mask);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+	__m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+	return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+COMPAT_AVX2_TARGET inline int horizontal_sum_avx2(__m256i acc)
+{
+	__m128i s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	return (int)(_mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1));
+}
+
+COMPAT_AVX2_TARGET inline int bits_and_popcount_avx2(const compat_word* a, const compat_word* b, int words)
+{
+	__m256i acc = _mm256_setzero_si256();
+	for (int w = 0; w < words; w += 4)
+	{
+		__m256i x = _mm256_and_si256(_mm256_load_si256((const __m256i*)(a + w)),
+			_mm256_load_si256((const __m256i*)(b + w)));
+		acc = _mm256_add_epi64(acc, popcount_avx2_lanes(x));
+	}
+	return horizontal_sum_avx2(acc);
+}
+
+COMPAT_AVX2_TARGET inline int bits_andnot_popcount_avx2(const compat_word* a, const compat_word* not_b, int words)
+{
+	__m256i acc = _mm256_setzero_si256();
+	for (int w = 0; w < words; w += 4)
+	{
+		/* _mm256_andnot_si256(x, y) computes ~x & y */
+		__m256i x = _mm256_andnot_si256(_mm256_load_si256((const __m256i*)(not_b + w)),
+			_mm256_load_si256((const __m256i*)(a + w)));
+		acc = _mm256_add_epi64(acc, popcount_avx2_lanes(x));
+	}
+	return horizontal_sum_avx2(acc);
+}
+
+inline int cpu_has_avx2()
+{
+#if defined(__AVX2__)
+	return 1;
+#else
+	static int has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	return has_avx2;
+#endif
+}
+#endif
+
+/* popcount(a & b) */
+inline int bits_and_popcount(const compat_word* a, const compat_word* b, int words)
+{
+#ifdef COMPAT_HAVE_AVX2_PATH
+	if (cpu_has_avx2())
+		return bits_and_popcount_avx2(a, b, words);
+#endif
+	return bits_and_popcount_scalar(a, b, words);
+}
+
+/* popcount(a & ~not_b) */
+inline int bits_andnot_popcount(const compat_word* a, const compat_word* not_b, int words)
+{
+#ifdef COMPAT_HAVE_AVX2_PATH
+	if (cpu_has_avx2())
+		return bits_andnot_popcount_avx2(a, not_b, words);
+#endif
+	return bits_andnot_popcount_scalar(a, not_b, words);
+}
+
+/* dst &= src */
+inline void bits_and_into(compat_word* dst, const compat_word* src, int words)
+{
+	for (int w = 0; w < words; w++)
+		dst[w] &= src[w];
+}
+
+/* dst = a & ~not_b */
+inline void bits_andnot(compat_word* dst, const compat_word* a, const compat_word* not_b, int words)
+{
+	for (int w = 0; w < words; w++)
+		dst[w] = a[w] & ~not_b[w];
+}
+
+#endif
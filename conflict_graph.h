@@ -0,0 +1,75 @@
+#ifndef CONFLICT_GRAPH_H
+#define CONFLICT_GRAPH_H
+
+#include <stddef.h>
+#include "synth_arena.h"
+
+/****************************************************************************
+*  Sparse conflict graph used by the clique partitioner.
+*
+*   o The complement of a compatibility graph: the list of node i holds the
+*     nodes that are NOT compatible with i, in increasing order.
+*   o Compressed sparse row (CSR) form: the conflicts of node i are
+*         neighbors[offsets[i]] .. neighbors[offsets[i+1] - 1]
+*   o Every node is compatible with itself and is never on its own list;
+*     the lists are symmetric (j on the list of i iff i on the list of j).
+*   o Storage is nodesize + 1 offsets plus one int per listed pair, so a
+*     graph in which most pairs are compatible costs a small fraction of
+*     the n x n bits of a compat_matrix (compat_matrix.h).
+****************************************************************************/
+
+struct conflict_graph
+{
+	int nodesize;               /* number of nodes */
+	size_t* offsets;            /* nodesize + 1 entries into neighbors */
+	int* neighbors;             /* all conflict lists, one after another */
+	synth_arena* arena;         /* where the lists (and the partitioner's scratch) come from */
+};
+
+/* room for nodesize lists holding "entries" neighbors in total (NULL arena: heap) */
+inline void conflict_graph_init(conflict_graph* g, int nodesize, size_t entries, synth_arena* arena)
+{
+	g->nodesize = nodesize;
+	g->arena = arena;
+	g->offsets = (size_t*)arena_alloc(arena, (nodesize + 1) * sizeof(size_t));
+	g->neighbors = (int*)arena_alloc(arena, entries * sizeof(int));
+	g->offsets[0] = 0;
+}
+
+inline void conflict_graph_free(conflict_graph* g)
+{
+	arena_free(g->arena, g->neighbors, g->offsets[g->nodesize] * sizeof(int));
+	arena_free(g->arena, g->offsets, (g->nodesize + 1) * sizeof(size_t));
+	g->offsets = NULL;
+	g->neighbors = NULL;
+	g->nodesize = 0;
+}
+
+inline int conflict_degree(const conflict_graph* g, int i)
+{
+	return (int)(g->offsets[i + 1] - g->offsets[i]);
+}
+
+inline const int* conflict_list(const conflict_graph* g, int i)
+{
+	return g->neighbors + g->offsets[i];
+}
+
+/* 1 if j is on the list of i (binary search) */
+inline int conflict_test(const conflict_graph* g, int i, int j)
+{
+	const int* list = conflict_list(g, i);
+	int lo = 0, hi = conflict_degree(g, i), mid = 0;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (list[mid] < j)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < conflict_degree(g, i) && list[lo] == j) ? 1 : 0;
+}
+
+#endif
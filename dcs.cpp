@@ -8,738 +8,515 @@
 #include <vector>
 #include <math.h>
 #include <algorithm>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <mutex>
 #include "allocate_binding.hpp"
 #include "multiplexor.hpp"
 #include "scheduler.hpp"
 #include "allocate_reg.hpp"
+#include "aif_reader.hpp"
+#include "vhdl_writer.hpp"
+#include "profile.hpp"
+#include "log.hpp"
 
 using namespace std;
 
-/*struct operation {
-	string type;
-	string operand1;
-	string operand2;
-	string output;
-	int timestep;
+struct designJob {
+	string input, output;
+	designJob(const string& in, const string& out) : input(in), output(out) {}
 };
 
-struct reg {
-	string name;
-	int first; //first timestep accessed
-	int last; //last timestep accessed
-};
-
-struct resource {
-	string type;
-	vector<int> clique;
-};
-
-struct mux {
-	int numInputs;
-	string resourceBoundTo;
-	int resourceIndex;
-};
-*/
-
-void writeVHDL();
-void printMultiplexerBindings();
-void allocateMultiplexers();
-void printRegisterBindings();
-void allocateRegisters();
-void printOperationBindings();
-void allocateFunctionalUnits();
-void printCompatibilityGraph(int** graph, int n);
-void createASAP();
-void printStructures();
-void readInputFile();
-
-/*
-vector<string> inputs, outputs;
-vector<operation> operations;
-vector<reg> registers;
-vector<resource> opResources;
-vector<vector<int> > regResources;
-vector<mux> muxResources;
-int inputBits = 0, outputBits = 0, registerBits = 0, operationBits = 0;
-int** regCompGraph, **funcCompGraph;
-*/
-
-int main()
+bool writeVHDL(synthesisContext& ctx, string outputFile);
+void printMemoryUsage(synthesisContext& ctx);
+void printMultiplexerBindings(synthesisContext& ctx);
+void allocateMultiplexers(synthesisContext& ctx);
+void printRegisterBindings(synthesisContext& ctx);
+void allocateRegisters(synthesisContext& ctx);
+void printOperationBindings(synthesisContext& ctx);
+void allocateFunctionalUnits(synthesisContext& ctx);
+void printCompatibilityGraph(const compat_matrix* graph);
+bool scheduleOperations(synthesisContext& ctx);
+void printStructures(synthesisContext& ctx);
+int synthesizeDesign(synthesisContext& ctx, const string& inputFile, const string& outputFile);
+string outputPathFor(const string& inputFile, const string& outputDir);
+bool readManifest(const string& manifest, const string& outputDir, vector<designJob>& jobs);
+int runBatch(const vector<designJob>& jobs, int threads, const string& profilePath);
+void printUsage(const char* program);
+bool parseFuLimits(const string& list);
+
+int main(int argc, char* argv[])
 {
-	readInputFile();
-
-	createASAP(); //step 1
-	printStructures();
-
-	allocateFunctionalUnits(); //step 2
-	printOperationBindings();
-
-	allocateRegisters(); //step 3
-	printRegisterBindings();
-
-	allocateMultiplexers(); //step 4
-	printMultiplexerBindings();
-
-	writeVHDL(); //step 5
+	vector<string> inputFiles;
+	string outputDir, manifest, profilePath;
+	int threads = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
 
-
-
-
-
-
-
-	return 0;
-}
-
-void writeVHDL()
-{
-	string outputFile;
-	int controlBits = 0, muxSelBits, muxNumInputs, muxMaxInputs;
-	int numAdder = 0, numSub = 0, numMult = 0, resourceNum;
-	int controlBitIndex = 0;
-	string resType, regName;
-	int resIndex, regIndex, opIndex, muxIndex;
-
-	cout << "\nFile to write: ";
-	cin >> outputFile;
-	ofstream fout;
-	fout.open(outputFile.c_str());
-
-	if (!fout) {
-		cout << "Could not open file " + outputFile + " for writing" << endl;
-		exit(2);
-	}
-
-	fout << "library IEEE;\n";
-	fout << "use IEEE.std_logic_1164.all;\n\n";
-
-	fout << "entity input_dp is\n";
-	fout << "port(\t";
-	for (int i = 0; i < inputs.size(); i++)
-		fout << inputs[i] << " : IN std_logic_vector(" << inputBits - 1 << " downto 0);\n\t";
-
-	for (int i = 0; i < outputs.size(); i++)
-		fout << outputs[i] << " : OUT std_logic_vector(" << outputBits - 1 << " downto 0);\n\t";
-
-	fout << "ctrl: IN std_logic_vector(";
-
-	controlBits += regResources.size();
-	for (int i = 0; i < muxResources.size(); i++)
+	for (int i = 1; i < argc; i++)
 	{
-		muxSelBits = 0;
-		muxMaxInputs = 1;
-		do
-		{
-			muxNumInputs = muxResources[i].numInputs;
-			muxSelBits++;
-			muxMaxInputs *= 2;
-		} while (muxNumInputs > muxMaxInputs);
-		controlBits += muxSelBits;
-	}
-	controlBits--;
-	fout << controlBits << " downto 0);\n\t clear: IN std_logic;\n\tclock: IN std_logic\n);\nend input_dp;\n";
-
-	fout << "\narchitecture RTL of input_dp is\n\n";
-
-	fout << "  component c_register\n";
-	fout << "  generic (width : integer := 4);\n";
-	fout << "  port (input : in std_logic_vector((width-1) downto 0);\n";
-	fout << "    WR: in std_logic;\n";
-	fout << "    clear : in std_logic;\n";
-	fout << "    clock : in std_logic;\n";
-	fout << "    output : out std_logic_vector((width -1) downto 0));\n";
-	fout << "  end component;\n\n";
-
-	fout << "  component C_Adder\n";
-	fout << "    generic (width : integer); \n";
-	fout << "    port(  input1 : in Std_logic_vector ((width - 1) downto 0); \n";
-	fout << "    input2 : in Std_logic_vector ((width - 1) downto 0); \n";
-	fout << "    output : out Std_logic_vector (width downto 0)); \n";
-	fout << "  end component;\n\n";
-
-	fout << "  component C_subtractor\n";
-	fout << "    generic (width : integer); \n";
-	fout << "    port(  input1 : in Std_logic_vector ((width - 1) downto 0); \n";
-	fout << "    input2 : in Std_logic_vector ((width - 1) downto 0); \n";
-	fout << "    output : out Std_logic_vector (width downto 0)); \n";
-	fout << "  end component; \n\n";
-
-	fout << "  component C_multiplier \n";
-	fout << "    generic (width : integer); \n";
-	fout << "    port(  input1 : in Std_logic_vector ((width - 1) downto 0); \n";
-	fout << "    input2 : in Std_logic_vector ((width - 1) downto 0); \n";
-	fout << "    output : out Std_logic_vector (((width * 2) - 2) downto 0)); \n";
-	fout << "  end component; \n\n";
-
-	fout << "  component C_Multiplexer\n";
-	fout << "    generic (width : integer;\n";
-	fout << "      no_of_inputs : integer;\n";
-	fout << "      select_size : integer); \n";
-	fout << "    port(  input : in Std_logic_vector (((width*no_of_inputs) - 1) downto 0);\n";
-	fout << "    MUX_SELECT : in Std_logic_vector ((select_size - 1) downto 0);\n";
-	fout << "    output : out Std_logic_vector ((width - 1) downto 0)); \n";
-	fout << "  end component; \n\n";
-
-	for (int i = 0; i < regResources.size(); i++)
-		fout << "\tsignal R" << i << "_out : Std_logic_vector(" << registerBits - 1 << " downto 0);\n";
-
-	fout << "\n";
-
-	for (int i = 0; i < opResources.size(); i++)
-	{
-		if (opResources[i].type == "MULT") {
-			resourceNum = 0;
-			fout << "\tsignal FU" << resourceNum << "_" << numMult;
-			numMult++;
-		}
-		else if (opResources[i].type == "SUB") {
-			resourceNum = 1;
-			fout << "\tsignal FU" << resourceNum << "_" << numSub;
-			numSub++;
+		string arg = argv[i];
+		if (arg == "--reg-binder=left-edge")
+			registerBinder = REG_BIND_LEFT_EDGE;
+		else if (arg == "--reg-binder=clique")
+			registerBinder = REG_BIND_CLIQUE;
+		else if (arg == "--fu-binder=step")
+			functionalUnitBinder = FU_BIND_STEP;
+		else if (arg == "--fu-binder=clique")
+			functionalUnitBinder = FU_BIND_CLIQUE;
+		else if (arg == "--scheduler=asap")
+			operationScheduler = SCHED_ASAP;
+		else if (arg == "--scheduler=list")
+			operationScheduler = SCHED_LIST;
+		else if (arg.compare(0, 12, "--fu-limits=") == 0 && parseFuLimits(arg.substr(12)))
+			operationScheduler = SCHED_LIST;
+		else if (arg.compare(0, 10, "--latency=") == 0 && atoi(arg.c_str() + 10) > 0) {
+			latencyBound = atoi(arg.c_str() + 10);
+			operationScheduler = SCHED_FORCE;
 		}
-		else if (opResources[i].type == "ADD") {
-			resourceNum = 2;
-			fout << "\tsignal FU" << resourceNum << "_" << numAdder;
-			numAdder++;
-		}
-		fout << "_out : Std_logic_vector(" << operationBits << " downto 0);\n";//ask Richard about FU signal length
-	}
-	fout << "\n";
-	for (int i = 0; i < muxResources.size(); i++)
-		fout << "\tsignal Mux" << i << "_out :  Std_logic_vector(" << inputBits << " downto 0);\n";
-
-	fout << "\nbegin\n\n";
-
-	muxIndex = 0;
-	for (int i = 0; i < regResources.size(); i++)
-	{
-
-		fout << "\tR" << i << "  : C_Register\n\t generic map(" << registerBits << ")\n";
-		fout << "\t port map (\n\t\t input(" << registerBits - 1 << " downto 0) => ";
-		if (muxIndex < muxResources.size() && muxResources[muxIndex].resourceBoundTo == "REG")
-		{
-			fout << "Mux" << muxIndex << "_out(" << inputBits - 1 << " downto 0),\n";
-			muxIndex++;
-
+		else if (arg.compare(0, 16, "--clique-starts=") == 0 && atoi(arg.c_str() + 16) > 0)
+			cliqueSearch.starts = atoi(arg.c_str() + 16);
+		else if (arg.compare(0, 14, "--clique-seed=") == 0 && arg.size() > 14)
+			cliqueSearch.seed = strtoul(arg.c_str() + 14, NULL, 10);
+		else if (arg.compare(0, 16, "--clique-budget=") == 0 && atof(arg.c_str() + 16) > 0)
+			cliqueSearch.budget_ms = atof(arg.c_str() + 16);
+		else if (arg == "--clique-goal=cliques")
+			cliqueSearch.goal = CLIQUE_FEWEST;
+		else if (arg == "--clique-goal=mux")
+			cliqueSearch.goal = CLIQUE_FEWEST_MUX_INPUTS;
+		else if (arg == "-o" && i + 1 < argc)
+			outputDir = argv[++i];
+		else if (arg == "-j" && i + 1 < argc && atoi(argv[i + 1]) > 0)
+			threads = atoi(argv[++i]);
+		else if (arg.compare(0, 7, "--jobs=") == 0 && atoi(arg.c_str() + 7) > 0)
+			threads = atoi(arg.c_str() + 7);
+		else if (arg.compare(0, 11, "--manifest=") == 0 && arg.size() > 11)
+			manifest = arg.substr(11);
+		else if (arg.compare(0, 10, "--profile=") == 0 && arg.size() > 10)
+			profilePath = arg.substr(10);
+		else if (arg.compare(0, 6, "--log=") == 0 && parseLogLevel(arg.substr(6), logVerbosity))
+			;
+		else if (arg == "-v" || arg == "--verbose")
+			logVerbosity = LOG_INFO;
+		else if (arg.compare(0, 11, "--log-file=") == 0 && arg.size() > 11) {
+			if (!logSink().openFile(arg.substr(11))) {
+				cout << "Could not open file " + arg.substr(11) + " for writing" << endl;
+				exit(1);
+			}
 		}
+		else if (arg.empty() || arg[0] != '-')
+			inputFiles.push_back(arg);
 		else {
-
-			fout << registers[regResources[i][0]].name << "(" << inputBits - 1 << " downto 0),\n";
+			cout << "Unknown option " << arg << endl;
+			printUsage(argv[0]);
+			exit(1);
 		}
-		fout << "\t\t WR => ctrl(" << i << "),\n\t\t CLEAR => clear,\n";
-		fout << "\t\t CLOCK => clock,\n\t\t output => R" << i << "_out);\n\n";
 	}
 
-	numAdder = numSub = numMult = 0;
-	for (int i = 0; i < opResources.size(); i++)
+	if (inputFiles.empty() && manifest.empty()) //no designs named, ask for one
 	{
-		fout << "\t" << opResources[i].type;
-		if (opResources[i].type == "MULT")
-		{
-			resourceNum = 0;
-			fout << resourceNum << "_" << numMult << " : C_Multiplier\n";
-		}
-		else if (opResources[i].type == "SUB")
-		{
-			resourceNum = 1;
-			fout << resourceNum << "_" << numSub << " : C_Subtractor\n";
-		}
-		else if (opResources[i].type == "ADD")
-		{
-			resourceNum = 2;
-			fout << resourceNum << "_" << numAdder << " : C_Adder\n";
+		if (!outputDir.empty()) {
+			printUsage(argv[0]);
+			exit(1);
 		}
-		fout << "\t\t generic map(" << operationBits << ")\n";
-		fout << "\t\t port map (\n";
-		fout << "\t\t input1(" << operationBits - 1 << " downto 0) => R";
-
-		int regIndex;
-		string regstring = operations[opResources[i].clique[0]].operand1;
-		for (int j = 0; j < registers.size(); j++)
-			if (registers[j].name == regstring)
-				regIndex = j;
-
-		for (int j = 0; j < regResources.size(); j++)
-			for (int k = 0; k < regResources[j].size(); k++)
-				if (regResources[j][k] == regIndex)
-					fout << j << "_out(" << operationBits - 1 << " downto 0),\n";
-
-		fout << "\t\t input2(" << operationBits - 1 << " downto 0) => R";
-
 
-		regstring = operations[opResources[i].clique[0]].operand2;
-		for (int j = 0; j < registers.size(); j++)
-			if (registers[j].name == regstring)
-				regIndex = j;
+		synthesisContext ctx;
+		designProfile profile;
+		string inputFile;
+		cout << "File to read: ";
+		cin >> inputFile;
 
-		for (int j = 0; j < regResources.size(); j++)
-			for (int k = 0; k < regResources[j].size(); k++)
-				if (regResources[j][k] == regIndex)
-					fout << j << "_out(" << operationBits - 1 << " downto 0),\n";
+		if (!profilePath.empty())
+			ctx.profile = &profile;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		int status = synthesizeDesign(ctx, inputFile, ""); //writeVHDL() asks for the output file
+		printMemoryUsage(ctx);
 
-		fout << "\t\t output(" << operationBits << " downto 0) => FU";
-
-
-		if (opResources[i].type == "MULT")
+		if (!profilePath.empty())
 		{
-			resourceNum = 0;
-			fout << resourceNum << "_" << numMult << "_out(";
-			numMult++;
-		}
-		else if (opResources[i].type == "SUB")
-		{
-			resourceNum = 1;
-			fout << resourceNum << "_" << numSub << "_out(";
-			numSub++;
-		}
-		else if (opResources[i].type == "ADD")
-		{
-			resourceNum = 2;
-			fout << resourceNum << "_" << numAdder << "_out(";
-			numAdder++;
+			profile.input = inputFile;
+			profile.status = status;
+			profile.totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			recordDesign(ctx);
+			if (!writeProfile(profilePath, vector<designProfile>(1, profile), 1, profile.totalMs)) {
+				cout << "Could not open file " + profilePath + " for writing" << endl;
+				if (status == 0)
+					status = 2;
+			}
 		}
-		fout << operationBits << " downto 0));\n\n";
+		return status;
 	}
 
-	controlBitIndex = regResources.size();
-	for (int i = 0; i < muxResources.size(); i++)
-	{
-		fout << "\tMUX" << i << " : C_Multiplexer\n";
-		fout << "\t\tgeneric map(" << inputBits << ", ";
-		fout << muxResources[i].numInputs << ", ";
-
-		muxSelBits = 0;
-		muxMaxInputs = 1;
-		do
-		{
-			muxNumInputs = muxResources[i].numInputs;
-			muxSelBits++;
-			muxMaxInputs *= 2;
-		} while (muxNumInputs > muxMaxInputs);
+	vector<designJob> jobs;
+	for (int i = 0; i < inputFiles.size(); i++)
+		jobs.push_back(designJob(inputFiles[i], outputPathFor(inputFiles[i], outputDir)));
+	if (!manifest.empty() && !readManifest(manifest, outputDir, jobs))
+		exit(1);
 
-		fout << muxSelBits << ")\n";
-		fout << "\t\tport map(\n";
+	return runBatch(jobs, threads, profilePath);
+}
 
-		for (int j = 0; j < muxNumInputs; j++)
-		{
-			fout << "\t\tinput(" << ((j + 1)*operationBits) - 1 << " downto " << j*operationBits << ") => ";
-			resType = muxResources[i].resourceBoundTo;
-			if (resType == "REG")
+//Synthesizes every job on a work-stealing pool of the given size. Each
+//design gets a context from a free list (so arenas are reused rather than
+//regrown) and the pool, so its big stages can split further. With one
+//thread the stages print straight to stdout as they go; with more, each
+//design's report is buffered and printed in one piece when it finishes.
+//Given a profile path, every design is profiled and the report written
+//there at the end.
+int runBatch(const vector<designJob>& jobs, int threads, const string& profilePath)
+{
+	workStealingPool pool(threads);
+	taskGroup batch;
+	vector<synthesisContext*> idle, contexts;
+	mutex idleLock, printLock;
+	int status = 0, failed = 0;
+	long long totalOperations = 0;
+	size_t arenaPeak = 0; //largest of any one design
+	vector<designProfile> profiles(profilePath.empty() ? 0 : jobs.size());
+	chrono::steady_clock::time_point batchStart = chrono::steady_clock::now();
+
+	for (int i = 0; i < jobs.size(); i++)
+		pool.submit(batch, [&, i] {
+			synthesisContext* ctx;
 			{
-				resIndex = muxResources[i].resourceIndex; //register index
-
-														  //fout << "\n" << regResources[resIndex].size();
-				regIndex = regResources[resIndex][j];
-				//fout << regIndex << "\n";
-				regName = registers[regIndex].name;
-				//fout << regName << "\n";
-				if (find(inputs.begin(), inputs.end(), regName) != inputs.end())//if it is found
-					fout << regName;
-				else
+				lock_guard<mutex> lock(idleLock);
+				if (idle.empty())
 				{
-					for (int k = 0; k < operations.size(); k++)//search for name in operations reg
-						if (operations[k].output == regName)
-							opIndex = k; //get index of operation which is in a clique.
-
-					for (int k = 0; k < opResources.size(); k++)
-						for (int r = 0; r < opResources[k].clique.size(); r++)
-							if (opResources[k].clique[r] == opIndex)
-								resIndex = k; //index in opresources of the FU
-
-					numAdder = numSub = numMult = 0;
-					if (opResources[resIndex].type == "MULT")
-					{
-						resourceNum = 0;
-						fout << "FU" << resourceNum << "_" << numMult << "_out";
-						numMult++;
-					}
-					else if (opResources[resIndex].type == "SUB")
-					{
-						resourceNum = 1;
-						fout << "FU" << resourceNum << "_" << numSub << "_out";
-						numSub++;
-					}
-					else if (opResources[resIndex].type == "ADD")
-					{
-						resourceNum = 2;
-						fout << "FU" << resourceNum << "_" << numAdder << "_out";
-						numAdder++;
-					}
-
+					contexts.push_back(new synthesisContext());
+					idle.push_back(contexts.back());
 				}
+				ctx = idle.back();
+				idle.pop_back();
+			}
 
+			ostringstream report;
+			ctx->report = (threads > 1) ? (ostream*)&report : &cout;
+			ctx->pool = &pool;
+			ctx->profile = profiles.empty() ? NULL : &profiles[i];
+			if (threads == 1 && logEnabled<LOG_INFO>())
+				cout << "==> " << jobs[i].input << " -> " << jobs[i].output << endl;
+
+			error_code ec; //the output's directory may not exist yet
+			filesystem::path outputParent = filesystem::path(jobs[i].output).parent_path();
+			if (!outputParent.empty())
+				filesystem::create_directories(outputParent, ec);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			int designStatus = synthesizeDesign(*ctx, jobs[i].input, jobs[i].output);
+			double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			int operations = ctx->operations.size();
+			if (ctx->profile != NULL)
+			{
+				ctx->profile->input = jobs[i].input;
+				ctx->profile->output = jobs[i].output;
+				ctx->profile->status = designStatus;
+				ctx->profile->totalMs = ms;
+				recordDesign(*ctx);
 			}
-			else //is a function unit, sub/add/mult
+
 			{
-				opIndex = muxResources[i].resourceIndex;
-				for (int k = 0; k < opResources[opIndex].clique.size(); k++) //search through clique
+				lock_guard<mutex> lock(printLock);
+				if (threads > 1 && logEnabled<LOG_INFO>())
+					cout << "==> " << jobs[i].input << " -> " << jobs[i].output << endl << report.str();
+				else if (threads > 1)
+					cout << report.str(); //errors only
+				cout << "==> " << jobs[i].input;
+				if (designStatus != 0)
 				{
-					opIndex = opResources[opIndex].clique[k];
-					regName = operations[opIndex].output;//get name of each register connected to the mux
-														 // find what register clique in regResources it is in
-					for (int p = 0; p < registers.size(); p++)
-						if (registers[p].name == regName)
-							regIndex = p;
-
-					for (int p = 0; p < regResources.size(); p++)
-						for (int r = 0; r < regResources[p].size(); r++)
-							if (regResources[p][r] == regIndex)
-								regIndex = p; //get the index of the function unit the register name is in
-
-
+					cout << " failed" << endl;
+					if (status == 0)
+						status = designStatus;
+					failed++;
 				}
-				fout << "R" << regIndex << "_out";
+				else
+				{
+					ostringstream line;
+					line << ": " << operations << " operations in " << fixed << setprecision(2) << ms << " ms";
+					cout << line.str() << endl;
+					totalOperations += operations;
+				}
+				arenaPeak = max(arenaPeak, ctx->synthArena.peak + ctx->regArena.peak);
 			}
-			fout << "(" << operationBits - 1 << " downto 0),\n";
-		}
-
-		fout << "\t\tMUX_SELECT(" << muxSelBits - 1 << " downto 0) => ctrl(";
-		fout << controlBitIndex + (muxSelBits - 1) << " downto " << controlBitIndex << "),\n";
-		controlBitIndex += muxSelBits;
-		fout << "\t\toutput => Mux" << i << "_out);\n";
-		fout << "\n";
-	}
 
-	for (int i = 0; i < outputs.size(); i++)
+			resetDesign(*ctx);
+			ctx->report = &cout;
+			ctx->profile = NULL;
+			lock_guard<mutex> lock(idleLock);
+			idle.push_back(ctx);
+		});
+	pool.wait(batch);
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - batchStart).count();
+	size_t reserved = 0;
+	for (int i = 0; i < contexts.size(); i++)
 	{
-		fout << "\t " << outputs[i] << "(" << outputBits - 1 << " downto 0) <= R";
-
-		for (int j = 0; j < registers.size(); j++)
-			if (registers[j].name == outputs[i])
-				regIndex = j;
+		reserved += contexts[i]->synthArena.reserved + contexts[i]->regArena.reserved;
+		delete contexts[i];
+	}
 
-		for (int j = 0; j < regResources.size(); j++)
-			for (int k = 0; k < regResources[j].size(); k++)
-				if (regResources[j][k] == regIndex)
-					fout << j << "_out(" << outputBits - 1 << " downto 0);\n";
+	ostringstream summary;
+	summary << "Synthesized " << jobs.size() - failed << " of " << jobs.size() << " designs in "
+		<< fixed << setprecision(3) << seconds << " s on " << pool.size() << " threads: "
+		<< setprecision(1) << (jobs.size() - failed) / seconds << " designs/s, "
+		<< setprecision(0) << totalOperations / seconds << " operations/s";
+	cout << endl << summary.str() << endl;
+	if (logEnabled<LOG_INFO>()) //arena use is shown with -v, as for a single design
+		cout << endl << "Synthesis arena: peak " << arenaPeak << " bytes, " << reserved << " bytes reserved" << endl;
+
+	if (!profilePath.empty() && !writeProfile(profilePath, profiles, pool.size(), seconds * 1000)) {
+		cout << "Could not open file " + profilePath + " for writing" << endl;
+		if (status == 0)
+			status = 2;
 	}
-	fout << "end RTL;\n";
+	return status;
 }
 
-void printMultiplexerBindings()
+//Runs every stage on one design and writes its VHDL. Returns 0, or the
+//exit status of the stage that failed: 1 reading, 3 scheduling, 2 writing.
+int synthesizeDesign(synthesisContext& ctx, const string& inputFile, const string& outputFile)
 {
-	cout << endl << "Multiplexer Allocation:" << endl;
-	for (int i = 0; i < muxResources.size(); i++)
 	{
-		cout << "Mux #" << i << ": ";
-		cout << muxResources[i].resourceBoundTo << " #" << muxResources[i].resourceIndex;
-		cout << " #Inputs: " << muxResources[i].numInputs << endl;
+		stageTimer timer(ctx, PROFILE_READ);
+		if (!readAIF(ctx, inputFile))
+			return 1;
 	}
-}
 
-/*void allocateMultiplexers()
-{
-	for (int i = 0; i < regResources.size(); i++)
-		if (regResources[i].size() > 1)
-		{
-			muxResources.push_back(mux());
-			muxResources.back().numInputs = regResources[i].size(); //clique size
-			muxResources.back().resourceBoundTo = "REG";
-			muxResources.back().resourceIndex = i;
-		}
+	{
+		stageTimer timer(ctx, PROFILE_SCHEDULE);
+		if (!scheduleOperations(ctx)) //step 1
+			return 3;
+	}
+	printStructures(ctx);
 
-	for (int i = 0; i < opResources.size(); i++)
-		if (opResources[i].clique.size() > 1)
-		{
-			muxResources.push_back(mux());
-			muxResources.back().numInputs = opResources[i].clique.size(); //num items in clique
-			muxResources.back().resourceBoundTo = opResources[i].type;
-			muxResources.back().resourceIndex = i;
-		}
-}*/
+	//steps 2 and 3 only read the schedule and write their own tables and
+	//arenas, so they run side by side; the muxes need both. Only the caller's
+	//side prints, so a serial run reports in the usual order.
+	parallelInvoke(ctx.pool,
+		[&ctx] {
+			{
+				stageTimer timer(ctx, PROFILE_FU_BIND);
+				allocateFunctionalUnits(ctx); //step 2
+			}
+			printOperationBindings(ctx);
+		},
+		[&ctx] {
+			stageTimer timer(ctx, PROFILE_REG_BIND);
+			allocateRegisters(ctx); //step 3
+		});
+	printRegisterBindings(ctx);
 
-void printRegisterBindings()
-{
-	for (int i = 0; i < regResources.size(); i++)
 	{
-		cout << "Register #" << i << ": ";
-		for (int j = 0; j < regResources[i].size(); j++)
-			cout << " " << regResources[i][j];
-		cout << endl;
+		stageTimer timer(ctx, PROFILE_MUX);
+		allocateMultiplexers(ctx); //step 4
 	}
+	printMultiplexerBindings(ctx);
+
+	if (!writeVHDL(ctx, outputFile)) //step 5
+		return 2;
+	return 0;
 }
 
-/*void allocateRegisters() //need to make it work for register
+//outputDir/<input file name up to its first '.'>.vhd
+string outputPathFor(const string& inputFile, const string& outputDir)
 {
-	int m = operations.size();//# of operations
-	int n; //length of a side of the compatibility matrix
-	int maxTimestep = 0;
+	string stem = filesystem::path(inputFile).filename().string();
+	stem = stem.substr(0, stem.find('.'));
+	if (stem.empty())
+		stem = "design";
+	return (filesystem::path(outputDir) / (stem + ".vhd")).string();
+}
 
-	for (int i = 0; i < inputs.size(); i++)
-	{
-		registers.push_back(reg());
-		registers.back().name = inputs[i];
-		registers.back().first = 0;
+//One design per line: "input.aif [output.vhd]". Blank lines and lines
+//starting with '#' are skipped; relative paths are taken from the
+//manifest's directory, and a missing output goes to outputDir as usual.
+bool readManifest(const string& manifest, const string& outputDir, vector<designJob>& jobs)
+{
+	ifstream in(manifest.c_str());
+	filesystem::path base = filesystem::path(manifest).parent_path();
+	string line;
+	int lineNumber = 0;
 
-		for (int j = 0; j < m; j++) //if operation has this input has an operand, inputs first/last are operation's timestep
-			if (operations[j].operand1 == inputs[i] || operations[j].operand2 == inputs[i])
-				registers.back().last = operations[j].timestep;
+	if (!in) {
+		cout << "Could not open manifest " << manifest << " for reading" << endl;
+		return false;
 	}
 
-	for (int i = 0; i < outputs.size(); i++)
+	while (getline(in, line))
 	{
-		registers.push_back(reg());
-		registers.back().name = outputs[i];
-
-		for (int j = 0; j < m; j++) //if operation has this output as an out, first timestep = this timestep and last = something else
-			if (operations[j].output == outputs[i])
-				registers.back().first = operations[j].timestep;
-
-		for (int j = 0; j < m; j++)
-			if (operations[j].timestep > maxTimestep)
-				maxTimestep = operations[j].timestep;
+		istringstream fields(line);
+		string input, output, extra;
+		lineNumber++;
+
+		if (!(fields >> input) || input[0] == '#')
+			continue;
+		fields >> output;
+		if (fields >> extra) {
+			cout << manifest << ":" << lineNumber << ": expected 'input.aif [output.vhd]', found '" << extra << "'" << endl;
+			return false;
+		}
 
-		registers.back().last = maxTimestep;
+		input = (base / input).lexically_normal().string();
+		output = output.empty() ? outputPathFor(input, outputDir) : (base / output).lexically_normal().string();
+		jobs.push_back(designJob(input, output));
 	}
+	return true;
+}
 
-	n = registers.size();
-
-	for (int i = 0; i < n; i++) //need to determine first time accessed and last time accessed for each edge aka register
-		for (int j = 0; j < m; j++)
-			if (operations[j].output == registers[i].name) //if output is our reg, first time it is written to
-				registers[i].first = operations[j].timestep;
-			else if ((operations[j].operand1 == registers[i].name) ||
-				(operations[j].operand2 == registers[i].name)) // if either input is our reg, last time it is read.
-				registers[i].last = operations[j].timestep;
-
-	regCompGraph = new int*[n];
-
-	for (int i = 0; i < n; i++) //declare empty comp graph filled with junk data
-		regCompGraph[i] = new int[n];
+void printUsage(const char* program)
+{
+	cout << "Usage: " << program << " [options] [in1.aif in2.aif ...] [--manifest=list.txt] [-o outdir/] [-j threads]" << endl;
+	cout << "Options: [--scheduler=asap|list] [--fu-limits=TYPE=N,...] [--latency=N]" << endl;
+	cout << "         [--fu-binder=clique|step] [--reg-binder=clique|left-edge]" << endl;
+	cout << "         [--clique-starts=N] [--clique-seed=S] [--clique-budget=ms] [--clique-goal=cliques|mux]" << endl;
+	cout << "                               best of N partitions with ties broken in seeded orders" << endl;
+	cout << "         [--profile=out.json]  stage timings and partitioner counters as JSON" << endl;
+	cout << "         [-v | --log=error|warn|info|debug|trace] [--log-file=path]" << endl;
+	cout << "By default only results and errors are printed; -v (info) adds the schedule, the bindings" << endl;
+	cout << "and arena use. debug and trace are partitioner traces and need a -DLOG_COMPILED_LEVEL=4 build." << endl;
+	cout << "With no input files the design and output file names are read from stdin." << endl;
+}
 
-	for (int i = 0; i < n; i++)
-		for (int j = 0; j < n; j++)
-			if ((i == j) || (registers[i].last <= registers[j].first) || (registers[i].first >= registers[j].last))
-			{
-				regCompGraph[i][j] = 1;
-				regCompGraph[j][i] = 1;
-			}
-			else {
-				regCompGraph[i][j] = 0;
-				regCompGraph[j][i] = 0;
-			}
+bool writeVHDL(synthesisContext& ctx, string outputFile) //empty outputFile: ask for it
+{
+	string text;
 
-			clique_partition(regCompGraph, n);
+	if (outputFile.empty()) {
+		cout << "\nFile to write: ";
+		cin >> outputFile;
+	}
 
-			int opIndex;
-			string type;
+	stageTimer timer(ctx, PROFILE_WRITE); //after the prompt
+	if (ctx.profile != NULL)
+		ctx.profile->output = outputFile;
+	emitVHDL(ctx, text);
+	if (!writeTextFile(outputFile, text)) {
+		*ctx.report << "Could not open file " + outputFile + " for writing" << endl;
+		return false;
+	}
+	return true;
+}
 
-			for (int i = 0; i < MAXCLIQUES; i++)
-			{
-				if (clique_set[i].size == UNKNOWN) break;
-				regResources.push_back(vector<int>());
-
-				for (int j = 0; j < MAXCLIQUES; j++)
-					if (clique_set[i].members[j] != UNKNOWN)
-						regResources[i].push_back(clique_set[i].members[j]);
-					else
-						break;
-			}
-}*/
+void printMemoryUsage(synthesisContext& ctx)
+{
+	if (!logEnabled<LOG_INFO>())
+		return;
+	//the binders' arenas may be in use at the same time, so their peaks add up
+	*ctx.report << endl << "Synthesis arena: peak " << ctx.synthArena.peak + ctx.regArena.peak << " bytes, ";
+	*ctx.report << ctx.synthArena.reserved + ctx.regArena.reserved << " bytes reserved" << endl;
+}
 
-void printOperationBindings()
+void printMultiplexerBindings(synthesisContext& ctx)
 {
-	for (int i = 0; i < opResources.size(); i++)
+	if (!logEnabled<LOG_INFO>())
+		return;
+	*ctx.report << endl << "Multiplexer Allocation:" << endl;
+	for (int i = 0; i < ctx.muxResources.size(); i++)
 	{
-		cout << "Functional Unit #" << i << ": ";
-		cout << opResources[i].type;
-		for (int j = 0; j < opResources[i].clique.size(); j++)
-			cout << " " << opResources[i].clique[j];
-		cout << endl;
+		*ctx.report << "Mux #" << i << ": ";
+		*ctx.report << ctx.muxResources[i].resourceBoundTo << " #" << ctx.muxResources[i].resourceIndex;
+		*ctx.report << " #Inputs: " << ctx.muxResources[i].numInputs << endl;
 	}
 }
 
-/*void allocateFunctionalUnits()
+void printRegisterBindings(synthesisContext& ctx)
 {
-	int n = operations.size(); //length of a side of this square matrix
-	funcCompGraph = new int*[n];
-
-	for (int i = 0; i < n; i++) //declare empty comp graph filled with junk data
-		funcCompGraph[i] = new int[n];
-
-	for (int i = 0; i < n; i++)
-		for (int j = 0; j < n; j++)
-			//check each op against all other ops. If op = op, or 
-			//if they are same type, different ops, and different timestep
-			if ((i == j) ||
-				((operations[i].type == operations[j].type) &&
-				(operations[i].timestep != operations[j].timestep)))
-			{
-				funcCompGraph[i][j] = 1;
-				funcCompGraph[j][i] = 1;
-			}
-			else {
-				funcCompGraph[i][j] = 0;
-				funcCompGraph[j][i] = 0;
-			}
-
-			clique_partition(funcCompGraph, n); //access results in clique_set[]
-
-			int opIndex;
-
-			for (int i = 0; i < MAXCLIQUES; i++)
-			{
-				if (clique_set[i].size == UNKNOWN) break;
-				opResources.push_back(resource());
-
-				opIndex = clique_set[i].members[0];
-				opResources[i].type = operations[opIndex].type;
-
-				for (int j = 0; j < MAXCLIQUES; j++)
-					if (clique_set[i].members[j] != UNKNOWN)
-						opResources[i].clique.push_back(clique_set[i].members[j]);
-					else
-						break;
-			}
-}*/
-
-void printCompatibilityGraph(int** graph, int n)
-{
-	cout << "Compatibility Graph:" << endl;
-	for (int i = 0; i < n; i++)
+	if (!logEnabled<LOG_INFO>())
+		return;
+	for (int i = 0; i < ctx.regResources.size(); i++)
 	{
-		for (int j = 0; j < n; j++)
-			cout << graph[i][j] << " ";
-		cout << endl;
+		*ctx.report << "Register #" << i << ": ";
+		for (int j = 0; j < ctx.regResources[i].size(); j++)
+			*ctx.report << " " << ctx.regResources[i][j];
+		*ctx.report << endl;
 	}
 }
 
-/*void createASAP()
+void printOperationBindings(synthesisContext& ctx)
 {
-	int operationsToSchedule = operations.size(), timestep = 0, operationIndex;
-	vector<string> scheduled = inputs;
-	vector<int> toSchedule;
-
-	while (operationsToSchedule != 0)
+	if (!logEnabled<LOG_INFO>())
+		return;
+	for (int i = 0; i < ctx.opResources.size(); i++)
 	{
-		timestep++;
-
-		for (int i = 0; i < operations.size(); i++) //find operations in current timestep
-			if (operations[i].timestep == 0)
-				if ((find(scheduled.begin(), scheduled.end(), operations[i].operand1) != scheduled.end()) && // if both operands are in the scheduled vector,
-					(find(scheduled.begin(), scheduled.end(), operations[i].operand2) != scheduled.end()))  // we can run this in the first timestep.
-					toSchedule.push_back(i);
-
-		while (!toSchedule.empty()) //once all operations that can be scheduled are found:
-		{
-			operationIndex = toSchedule.back();
-			toSchedule.pop_back();
-			operations[operationIndex].timestep = timestep; //update each operation with its timestep
-			scheduled.push_back(operations[operationIndex].output); //add each operation that is now scheduled to the scheduled vector
-			operationsToSchedule--; //update # of operations left to be assigned a timestep
-		}
+		*ctx.report << "Functional Unit #" << i << ": ";
+		*ctx.report << ctx.opResources[i].type;
+		for (int j = 0; j < ctx.opResources[i].clique.size(); j++)
+			*ctx.report << " " << ctx.opResources[i].clique[j];
+		*ctx.report << endl;
 	}
-}*/
+}
 
-void printStructures()
+void printCompatibilityGraph(const compat_matrix* graph)
 {
-	cout << endl;
-	cout << "Input Bit Size:     " << inputBits << endl;
-	cout << "Output Bit Size:    " << outputBits << endl;
-	cout << "Register Bit Size:  " << registerBits << endl;
-	cout << "Operation Bit Size: " << operationBits << endl;
-
-	cout << endl << "Inputs:    ";
-	for (int i = 0; i < inputs.size(); i++)
-		cout << inputs[i] + " ";
-
-	cout << endl << "Outputs:   ";
-	for (int i = 0; i < outputs.size(); i++)
-		cout << outputs[i] + " ";
-
-	cout << endl << "Registers: ";
-	for (int i = 0; i < registers.size(); i++)
-		cout << registers[i].name + " ";
-
-	cout << endl << endl << "Operations:" << endl;
-	cout << setw(10) << left << "TYPE";
-	cout << setw(10) << left << "OP1";
-	cout << setw(10) << left << "OP2";
-	cout << setw(10) << left << "OUT";
-	cout << setw(10) << left << "TIME" << endl;
-	cout << "--------------------------------------------------" << endl;
-
-	for (int i = 0; i < operations.size(); i++)
+	cout << "Compatibility Graph:" << endl;
+	for (int i = 0; i < graph->nodesize; i++)
 	{
-		cout << setw(10) << left << operations[i].type;
-		cout << setw(10) << left << operations[i].operand1;
-		cout << setw(10) << left << operations[i].operand2;
-		cout << setw(10) << left << operations[i].output;
-		cout << setw(10) << left << operations[i].timestep << endl;
+		for (int j = 0; j < graph->nodesize; j++)
+			cout << compat_test(graph, i, j) << " ";
+		cout << endl;
 	}
-	cout << endl << endl;
 }
 
-void readInputFile()
+void printStructures(synthesisContext& ctx)
 {
-	string inputFile, line;
-	int i = -1;
-
-	cout << "File to read: ";
-	cin >> inputFile;
-
-	ifstream in;
-	in.open(inputFile.c_str());
-
-	if (!in) {
-		cout << "Could not open file " + inputFile + " for reading" << endl;
-		exit(1);
+	if (!logEnabled<LOG_INFO>())
+		return;
+	*ctx.report << endl;
+	*ctx.report << "Input Bit Size:     " << ctx.inputBits << endl;
+	*ctx.report << "Output Bit Size:    " << ctx.outputBits << endl;
+	*ctx.report << "Register Bit Size:  " << ctx.registerBits << endl;
+	*ctx.report << "Operation Bit Size: " << ctx.operationBits << endl;
+
+	*ctx.report << endl << "Inputs:    ";
+	for (int i = 0; i < ctx.inputs.size(); i++)
+		*ctx.report << ctx.symbols[ctx.inputs[i]].name << ":" << ctx.symbols[ctx.inputs[i]].width << " ";
+
+	*ctx.report << endl << "Outputs:   ";
+	for (int i = 0; i < ctx.outputs.size(); i++)
+		*ctx.report << ctx.symbols[ctx.outputs[i]].name << ":" << ctx.symbols[ctx.outputs[i]].width << " ";
+
+	*ctx.report << endl << "Registers: ";
+	for (int i = 0; i < ctx.registers.size(); i++)
+		*ctx.report << ctx.symbols[ctx.registers[i].symbolId].name << ":" << ctx.symbols[ctx.registers[i].symbolId].width << " ";
+
+	*ctx.report << endl << endl << "Operations:" << endl;
+	*ctx.report << setw(10) << left << "TYPE";
+	*ctx.report << setw(10) << left << "OP1";
+	*ctx.report << setw(10) << left << "OP2";
+	*ctx.report << setw(10) << left << "OUT";
+	*ctx.report << setw(10) << left << "TIME" << endl;
+	*ctx.report << "--------------------------------------------------" << endl;
+
+	for (int i = 0; i < ctx.operations.size(); i++)
+	{
+		*ctx.report << setw(10) << left << ctx.operations[i].type;
+		*ctx.report << setw(10) << left << ctx.symbols[ctx.operations[i].operand1].name;
+		*ctx.report << setw(10) << left << ctx.symbols[ctx.operations[i].operand2].name;
+		*ctx.report << setw(10) << left << ctx.symbols[ctx.operations[i].output].name;
+		*ctx.report << setw(10) << left << ctx.operations[i].timestep << endl;
 	}
+	*ctx.report << endl << endl;
+}
 
-	in >> line; //string "inputs"
+bool parseFuLimits(const string& list) //"MULT=2,SUB=1" into fuLimits, false if malformed
+{
+	size_t start = 0;
 
-	i = -1;
-	in >> line; //first input
-	while (line != "outputs") //Read in the inputs
+	while (start < list.size())
 	{
-		i++;
-		inputs.push_back(line);
-		in >> line; //input bit size
-		if (i == 0) inputBits = atoi(line.c_str());
-		in >> line; //either next input name, or next line starting with "outputs"
-	}
+		size_t end = list.find(',', start);
+		if (end == string::npos)
+			end = list.size();
 
-	i = -1;
-	in >> line; //first output
-	while (line != "regs") //Read in the outputs
-	{
-		i++;
-		outputs.push_back(line);
-		in >> line; //output bit size
-		if (i == 0) outputBits = atoi(line.c_str());
-		in >> line; //either next output name, or next line starting with "regs"
-	}
+		string entry = list.substr(start, end - start);
+		size_t eq = entry.find('=');
+		if (eq == string::npos || eq == 0 || eq + 1 == entry.size())
+			return false;
 
-	i = -1;
-	in >> line; //first register
-	while (line != "op1") //Read in the registers
-	{
-		i++;
-		registers.push_back(reg());
-		registers[i].name = line;
-		registers[i].first = 0;
-		registers[i].last = 0;
-		in >> line; //register bit size
-		if (i == 0) registerBits = atoi(line.c_str());
-		in >> line; //either next register name, or next line starting with "op1"
-	}
+		int count = atoi(entry.c_str() + eq + 1);
+		if (count < 1 || entry.find_first_not_of("0123456789", eq + 1) != string::npos)
+			return false;
 
-	i = -1;
-	while (line != "end") //Read in the operations
-	{
-		i++;
-		operations.push_back(operation());
-		in >> line; //type
-		operations[i].type = line;
-		in >> line; //bitsize
-		if (i == 0) operationBits = atoi(line.c_str());
-		in >> line; //operand1
-		operations[i].operand1 = line;
-		in >> line; //operand2
-		operations[i].operand2 = line;
-		in >> line; //output
-		operations[i].output = line;
-		in >> line; //next operation or "end"
-		operations[i].timestep = 0;
+		fuLimits[entry.substr(0, eq)] = count;
+		start = end + 1;
 	}
+	return !fuLimits.empty();
 }
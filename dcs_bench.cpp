@@ -0,0 +1,460 @@
+// Datapath Synthesis Tool: stage benchmark
+//
+// Builds synthetic designs, runs them through the synthesis stages one at a
+// time and reports how long each stage takes per operation, the peak
+// resident set size, and how each stage scales with design size.
+//
+//   g++ -O2 -std=c++17 dcs_bench.cpp -o dcs_bench -lpthread
+//   ./dcs_bench [--families=layered,fir,fft,matmul,chain] [--sizes=10,100,...]
+//               [--reps=N] [--clique-limit=N] [-j N] [--keep=dir]
+//
+// Design families (sizes are target operation counts; each family rounds
+// to the nearest size its structure allows):
+//   layered  random layered DAG, sqrt(n) operations wide, operands drawn from
+//            the previous few layers; many results are never read, so its
+//            reg-bind exponent also covers the left-edge binder's dead values
+//   fir      direct-form FIR filter: one MULT per tap, a chain of ADDs
+//   fft      radix-2 FFT butterflies (MULT by twiddle, ADD, SUB)
+//   matmul   k x k matrix product, every element a balanced ADD tree of k MULTs
+//   chain    one long dependency chain
+//
+// The clique binders need an n x n comp graph, so designs above
+// --clique-limit operations (default 4096) are bound with the step and
+// left-edge binders instead; the binder column says which ran.
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include "aif_reader.hpp"
+#include "vhdl_writer.hpp"
+
+using namespace std;
+
+enum benchStage { STAGE_READ, STAGE_SCHEDULE, STAGE_FU_BIND, STAGE_REG_BIND, STAGE_MUX, STAGE_EMIT, NUM_STAGES };
+const char* stageNames[NUM_STAGES] = { "read", "schedule", "fu-bind", "reg-bind", "mux", "emit" };
+
+struct benchResult {
+	string family;
+	int operations;
+	bool clique; //clique binders (else step / left-edge)
+	double seconds[NUM_STAGES]; //best of the repetitions
+	long peakRSS; //kB
+	size_t vhdlBytes;
+};
+
+//AIF text of a design, built up one declaration and operation at a time
+struct aifBuilder {
+	vector<string> inputs, outputs, regs;
+	ostringstream ops;
+	int numOps, width;
+
+	aifBuilder() : numOps(0), width(16) {}
+
+	string input(const string& name)
+	{
+		inputs.push_back(name);
+		return name;
+	}
+
+	//a new signal type(a, b); kept in a register unless marked as an output later
+	string op(const char* type, const string& a, const string& b)
+	{
+		string out = "t" + to_string(numOps);
+		numOps++;
+		ops << "op" << numOps << " " << type << " " << width << " " << a << " " << b << " " << out << "\n";
+		regs.push_back(out);
+		return out;
+	}
+
+	string text(const vector<string>& results)
+	{
+		ostringstream aif;
+		vector<bool> isOutput(numOps, false);
+
+		for (int i = 0; i < results.size(); i++)
+			isOutput[atoi(results[i].c_str() + 1)] = true;
+
+		aif << "inputs";
+		for (int i = 0; i < inputs.size(); i++)
+			aif << " " << inputs[i] << " " << width;
+		aif << "\noutputs";
+		for (int i = 0; i < results.size(); i++)
+			aif << " " << results[i] << " " << width;
+		aif << "\nregs";
+		for (int i = 0; i < regs.size(); i++)
+			if (!isOutput[i])
+				aif << " " << regs[i] << " " << width;
+		aif << "\n" << ops.str() << "end\n";
+		return aif.str();
+	}
+};
+
+const char* opTypes[3] = { "ADD", "SUB", "MULT" };
+
+string layeredDesign(int n, unsigned seed)
+{
+	aifBuilder b;
+	mt19937 rng(seed);
+	int width = max(2, (int)sqrt((double)n));
+	vector<vector<string> > layers(1);
+
+	for (int i = 0; i < width; i++)
+		layers[0].push_back(b.input("x" + to_string(i)));
+
+	while (b.numOps < n)
+	{
+		layers.push_back(vector<string>());
+		for (int i = 0; i < width && b.numOps < n; i++)
+		{
+			//operands from the last three layers, mostly the previous one
+			string operands[2];
+			for (int k = 0; k < 2; k++)
+			{
+				int back = (rng() % 4 == 0) ? rng() % 3 : 0;
+				vector<string>& from = layers[max(0, (int)layers.size() - 2 - back)];
+				operands[k] = from[rng() % from.size()];
+			}
+			layers.back().push_back(b.op(opTypes[rng() % 3], operands[0], operands[1]));
+		}
+	}
+	return b.text(layers.back());
+}
+
+string firDesign(int n)
+{
+	aifBuilder b;
+	int taps = max(1, (n + 1) / 2);
+	string sum;
+
+	for (int i = 0; i < taps; i++)
+	{
+		string product = b.op("MULT", b.input("x" + to_string(i)), b.input("h" + to_string(i)));
+		sum = (i == 0) ? product : b.op("ADD", sum, product);
+	}
+	return b.text(vector<string>(1, sum));
+}
+
+string fftDesign(int n)
+{
+	aifBuilder b;
+	int points = 2, stages = 1;
+
+	//3 ops per butterfly, points / 2 butterflies per stage, log2(points)
+	//stages: grow while the next power of two still fits in n
+	while (3 * points * (stages + 1) <= n)
+	{
+		points *= 2;
+		stages++;
+	}
+
+	vector<string> x(points), w(points / 2);
+	for (int i = 0; i < points; i++)
+		x[i] = b.input("x" + to_string(i));
+	for (int i = 0; i < points / 2; i++)
+		w[i] = b.input("w" + to_string(i));
+
+	for (int span = points / 2; span >= 1; span /= 2)
+		for (int start = 0; start < points; start += 2 * span)
+			for (int k = 0; k < span; k++)
+			{
+				string t = b.op("MULT", x[start + k + span], w[k * (points / 2 / span)]);
+				string top = b.op("ADD", x[start + k], t);
+				x[start + k + span] = b.op("SUB", x[start + k], t);
+				x[start + k] = top;
+			}
+	return b.text(x);
+}
+
+string matmulDesign(int n)
+{
+	aifBuilder b;
+	int k = max(1, (int)round(cbrt(n / 2.0))); //k * k elements of 2k - 1 ops
+	vector<string> c;
+
+	for (int i = 0; i < k; i++)
+		for (int j = 0; j < k; j++)
+		{
+			b.input("a" + to_string(i) + "_" + to_string(j));
+			b.input("b" + to_string(i) + "_" + to_string(j));
+		}
+
+	for (int i = 0; i < k; i++)
+		for (int j = 0; j < k; j++)
+		{
+			vector<string> terms;
+			for (int m = 0; m < k; m++)
+				terms.push_back(b.op("MULT", "a" + to_string(i) + "_" + to_string(m), "b" + to_string(m) + "_" + to_string(j)));
+			while (terms.size() > 1) //balanced adder tree
+			{
+				vector<string> next;
+				for (int t = 0; t + 1 < terms.size(); t += 2)
+					next.push_back(b.op("ADD", terms[t], terms[t + 1]));
+				if (terms.size() % 2 == 1)
+					next.push_back(terms.back());
+				terms.swap(next);
+			}
+			c.push_back(terms[0]);
+		}
+
+	//a 1 x 1 product is a single MULT, which is already an output
+	return b.text(c);
+}
+
+string chainDesign(int n)
+{
+	aifBuilder b;
+	string acc = b.input("x0");
+
+	for (int i = 0; i < 8; i++)
+		b.input("k" + to_string(i));
+	for (int i = 0; i < n; i++)
+		acc = b.op(opTypes[i % 3], acc, "k" + to_string(i % 8));
+	return b.text(vector<string>(1, acc));
+}
+
+string generateDesign(const string& family, int n)
+{
+	if (family == "layered")
+		return layeredDesign(n, 12345 + n);
+	if (family == "fir")
+		return firDesign(n);
+	if (family == "fft")
+		return fftDesign(n);
+	if (family == "matmul")
+		return matmulDesign(n);
+	return chainDesign(n);
+}
+
+//Peak RSS in kB since the last call. Linux can reset the high-water mark
+//through clear_refs; elsewhere this is the peak of the whole process.
+long peakRSSSinceLastCall()
+{
+	long kB = -1;
+	ifstream status("/proc/self/status");
+	string line;
+
+	while (getline(status, line))
+		if (line.compare(0, 6, "VmHWM:") == 0)
+			kB = atol(line.c_str() + 6);
+	if (kB < 0)
+	{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		kB = usage.ru_maxrss;
+	}
+
+	ofstream clear("/proc/self/clear_refs");
+	if (clear)
+		clear << "5" << endl;
+	return kB;
+}
+
+//Runs one design through every stage, each timed on its own
+bool runStages(const string& path, bool clique, workStealingPool* pool, double seconds[NUM_STAGES], int& operations, size_t& vhdlBytes)
+{
+	synthesisContext ctx;
+	ostringstream report; //the stages' own printouts are not part of the benchmark
+	string vhdl;
+	chrono::steady_clock::time_point t[NUM_STAGES + 1];
+
+	ctx.report = &report;
+	ctx.pool = pool;
+	functionalUnitBinder = clique ? FU_BIND_CLIQUE : FU_BIND_STEP;
+	registerBinder = clique ? REG_BIND_CLIQUE : REG_BIND_LEFT_EDGE;
+
+	t[STAGE_READ] = chrono::steady_clock::now();
+	if (!readAIF(ctx, path))
+		return false;
+	t[STAGE_SCHEDULE] = chrono::steady_clock::now();
+	if (!scheduleOperations(ctx))
+		return false;
+	t[STAGE_FU_BIND] = chrono::steady_clock::now();
+	allocateFunctionalUnits(ctx);
+	t[STAGE_REG_BIND] = chrono::steady_clock::now();
+	allocateRegisters(ctx);
+	t[STAGE_MUX] = chrono::steady_clock::now();
+	allocateMultiplexers(ctx);
+	t[STAGE_EMIT] = chrono::steady_clock::now();
+	emitVHDL(ctx, vhdl);
+	t[NUM_STAGES] = chrono::steady_clock::now();
+
+	for (int s = 0; s < NUM_STAGES; s++)
+		seconds[s] = chrono::duration<double>(t[s + 1] - t[s]).count();
+	operations = ctx.operations.size();
+	vhdlBytes = vhdl.size();
+	return true;
+}
+
+//Least-squares slope of log(seconds) over log(operations), time ~ ops^slope,
+//over the family's designs of 500+ operations that used the same binders
+//as its largest one
+double scalingExponent(const vector<benchResult>& results, const string& family, int stage)
+{
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	int points = 0, largest = -1;
+
+	for (int i = 0; i < results.size(); i++)
+		if (results[i].family == family && (largest == -1 || results[i].operations > results[largest].operations))
+			largest = i;
+
+	for (int i = 0; i < results.size(); i++)
+		if (results[i].family == family && results[i].clique == results[largest].clique &&
+			results[i].operations >= 500 && results[i].seconds[stage] > 0)
+		{
+			double x = log((double)results[i].operations), y = log(results[i].seconds[stage]);
+			sx += x; sy += y; sxx += x * x; sxy += x * y;
+			points++;
+		}
+	if (points < 2 || points * sxx - sx * sx <= 0)
+		return NAN;
+	return (points * sxy - sx * sy) / (points * sxx - sx * sx);
+}
+
+vector<string> splitList(const string& list)
+{
+	vector<string> items;
+	stringstream in(list);
+	string item;
+
+	while (getline(in, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+int main(int argc, char* argv[])
+{
+	vector<string> families = splitList("layered,fir,fft,matmul,chain");
+	vector<string> sizeList = splitList("10,100,1000,10000,100000");
+	int reps = 3, cliqueLimit = 4096, threads = 1;
+	string keepDir;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 11, "--families=") == 0)
+			families = splitList(arg.substr(11));
+		else if (arg.compare(0, 8, "--sizes=") == 0)
+			sizeList = splitList(arg.substr(8));
+		else if (arg.compare(0, 7, "--reps=") == 0 && atoi(arg.c_str() + 7) > 0)
+			reps = atoi(arg.c_str() + 7);
+		else if (arg.compare(0, 15, "--clique-limit=") == 0)
+			cliqueLimit = atoi(arg.c_str() + 15);
+		else if (arg == "-j" && i + 1 < argc && atoi(argv[i + 1]) > 0)
+			threads = atoi(argv[++i]);
+		else if (arg.compare(0, 7, "--keep=") == 0)
+			keepDir = arg.substr(7);
+		else {
+			cerr << "Usage: " << argv[0] << " [--families=layered,fir,fft,matmul,chain] [--sizes=10,100,...]"
+				<< " [--reps=N] [--clique-limit=N] [-j N] [--keep=dir]" << endl;
+			return 1;
+		}
+	}
+
+	FILE* out = stdout; //the stages are quiet at the default log level
+
+	filesystem::path dir = keepDir.empty() ? filesystem::temp_directory_path() : filesystem::path(keepDir);
+	filesystem::create_directories(dir);
+	workStealingPool* pool = threads > 1 ? new workStealingPool(threads) : NULL;
+	vector<benchResult> results;
+
+	fprintf(out, "%-8s %8s %-6s", "family", "ops", "binder");
+	for (int s = 0; s < NUM_STAGES; s++)
+		fprintf(out, " %9s", stageNames[s]);
+	fprintf(out, " %10s %9s %10s\n", "total ms", "peak MB", "VHDL kB");
+	fprintf(out, "%-8s %8s %-6s", "", "", "");
+	for (int s = 0; s < NUM_STAGES; s++)
+		fprintf(out, " %9s", "ns/op");
+	fprintf(out, "\n");
+
+	for (int f = 0; f < families.size(); f++)
+		for (int z = 0; z < sizeList.size(); z++)
+		{
+			benchResult r;
+			string path = (dir / (families[f] + "_" + sizeList[z] + ".aif")).string();
+
+			{
+				ofstream aif(path.c_str());
+				aif << generateDesign(families[f], atoi(sizeList[z].c_str()));
+			}
+
+			r.family = families[f];
+			r.operations = 0;
+			r.clique = true;
+			for (int s = 0; s < NUM_STAGES; s++)
+				r.seconds[s] = INFINITY;
+
+			//a dry read tells the size, which picks the binders
+			{
+				synthesisContext probe;
+				ostringstream discard;
+				probe.report = &discard;
+				if (!readAIF(probe, path))
+				{
+					fprintf(out, "%-8s %8s  could not read the generated design\n", families[f].c_str(), sizeList[z].c_str());
+					continue;
+				}
+				r.clique = (int)probe.operations.size() <= cliqueLimit;
+			}
+
+			peakRSSSinceLastCall();
+			bool ok = true;
+			for (int rep = 0; rep < reps && ok; rep++)
+			{
+				double seconds[NUM_STAGES];
+				ok = runStages(path, r.clique, pool, seconds, r.operations, r.vhdlBytes);
+				for (int s = 0; s < NUM_STAGES; s++)
+					r.seconds[s] = min(r.seconds[s], seconds[s]);
+			}
+			r.peakRSS = peakRSSSinceLastCall();
+			if (keepDir.empty())
+				filesystem::remove(path);
+			if (!ok)
+			{
+				fprintf(out, "%-8s %8s  synthesis failed\n", families[f].c_str(), sizeList[z].c_str());
+				continue;
+			}
+
+			double total = 0;
+			fprintf(out, "%-8s %8d %-6s", r.family.c_str(), r.operations, r.clique ? "clique" : "fast");
+			for (int s = 0; s < NUM_STAGES; s++)
+			{
+				fprintf(out, " %9.1f", r.seconds[s] * 1e9 / max(r.operations, 1));
+				total += r.seconds[s];
+			}
+			fprintf(out, " %10.2f %9.1f %10.1f\n", total * 1e3, r.peakRSS / 1024.0, r.vhdlBytes / 1024.0);
+			fflush(out);
+			results.push_back(r);
+		}
+
+	fprintf(out, "\nScaling exponents (time ~ ops^k, fitted over designs of 500+ operations):\n");
+	fprintf(out, "%-8s", "family");
+	for (int s = 0; s < NUM_STAGES; s++)
+		fprintf(out, " %9s", stageNames[s]);
+	fprintf(out, "\n");
+	for (int f = 0; f < families.size(); f++)
+	{
+		fprintf(out, "%-8s", families[f].c_str());
+		for (int s = 0; s < NUM_STAGES; s++)
+		{
+			double k = scalingExponent(results, families[f], s);
+			if (isnan(k))
+				fprintf(out, " %9s", "-");
+			else
+				fprintf(out, " %9.2f", k);
+		}
+		fprintf(out, "\n");
+	}
+
+	delete pool;
+	return 0;
+}
@@ -0,0 +1,209 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdarg.h>
+#include <stdio.h>
+
+using namespace std;
+
+//Leveled logging.
+//
+//Two gates decide whether a message is written:
+//  o LOG_COMPILED_LEVEL, fixed at build time: anything above it is removed
+//    by if constexpr, loops and all. It defaults to LOG_INFO, so the
+//    partitioner's debug and trace output costs nothing in a normal build;
+//    build with -DLOG_COMPILED_LEVEL=4 (or the old -DDEBUG) to keep it.
+//  o logVerbosity, set once from the command line (--log=, -v): LOG_WARN by
+//    default, so a run prints its results and errors and nothing else.
+//
+//Messages go to an asynchronous sink: callers only append to a buffer in
+//memory, and a writer thread empties it to stderr (or the --log-file) in
+//large writes. A caller waits only when the writer falls far behind. The
+//buffer is drained when the program exits, including through exit().
+
+enum logLevel { LOG_ERROR, LOG_WARN, LOG_INFO, LOG_DEBUG, LOG_TRACE };
+
+#ifndef LOG_COMPILED_LEVEL
+#if defined(DEBUG)
+#define LOG_COMPILED_LEVEL LOG_TRACE
+#else
+#define LOG_COMPILED_LEVEL LOG_INFO
+#endif
+#endif
+
+logLevel logVerbosity = LOG_WARN; //how much a run prints, from the command line
+
+bool parseLogLevel(const string& name, logLevel& level)
+{
+	const char* names[] = { "error", "warn", "info", "debug", "trace" };
+
+	for (int i = 0; i <= LOG_TRACE; i++)
+		if (name == names[i])
+		{
+			level = (logLevel)i;
+			return true;
+		}
+	return false;
+}
+
+//true when messages of this level are compiled in
+template <logLevel level>
+constexpr bool logCompiled()
+{
+	return level <= LOG_COMPILED_LEVEL;
+}
+
+//true when messages of this level are compiled in and wanted
+template <logLevel level>
+inline bool logEnabled()
+{
+	if constexpr (!logCompiled<level>())
+		return false;
+	else
+		return level <= logVerbosity;
+}
+
+class asyncLogSink {
+public:
+	asyncLogSink() : out(stderr), stopping(false), writing(false) {}
+
+	~asyncLogSink()
+	{
+		{
+			lock_guard<mutex> lock(bufferLock);
+			stopping = true;
+		}
+		wake.notify_one();
+		if (writer.joinable())
+			writer.join();
+		else
+			flushPending(); //never started a writer
+		if (out != stderr)
+			fclose(out);
+	}
+
+	//must be called before the first message
+	bool openFile(const string& path)
+	{
+		FILE* f = fopen(path.c_str(), "w");
+		if (f == NULL)
+			return false;
+		out = f;
+		return true;
+	}
+
+	void append(const char* text, size_t length)
+	{
+		unique_lock<mutex> lock(bufferLock);
+		drained.wait(lock, [this] { return pending.size() < maxPending; }); //back-pressure only
+		pending.append(text, length);
+		if (!writer.joinable())
+			writer = thread(&asyncLogSink::writerLoop, this);
+		if (pending.size() >= wakeBytes)
+			wake.notify_one();
+	}
+
+	//blocks until everything appended so far is written
+	void flush()
+	{
+		unique_lock<mutex> lock(bufferLock);
+		wake.notify_one();
+		drained.wait(lock, [this] { return pending.empty() && !writing; });
+		fflush(out);
+	}
+
+private:
+	static constexpr size_t wakeBytes = 64 * 1024;
+	static constexpr size_t maxPending = 16 * 1024 * 1024;
+
+	FILE* out;
+	mutex bufferLock;
+	condition_variable wake, drained;
+	string pending;
+	bool stopping, writing;
+	thread writer;
+
+	void flushPending()
+	{
+		fwrite(pending.data(), 1, pending.size(), out);
+		pending.clear();
+		fflush(out);
+	}
+
+	void writerLoop()
+	{
+		string block;
+		unique_lock<mutex> lock(bufferLock);
+
+		for (;;)
+		{
+			//wake on a full block, a flush, or every few milliseconds
+			wake.wait_for(lock, chrono::milliseconds(20), [this] { return stopping || pending.size() >= wakeBytes; });
+			if (pending.empty())
+			{
+				drained.notify_all();
+				if (stopping)
+					return;
+				continue;
+			}
+
+			block.swap(pending);
+			writing = true;
+			lock.unlock();
+			fwrite(block.data(), 1, block.size(), out);
+			fflush(out);
+			block.clear();
+			lock.lock();
+			writing = false;
+			drained.notify_all();
+		}
+	}
+};
+
+asyncLogSink& logSink()
+{
+	static asyncLogSink sink;
+	return sink;
+}
+
+void logWrite(const char* format, va_list args)
+{
+	char line[512];
+	va_list again;
+
+	va_copy(again, args);
+	int length = vsnprintf(line, sizeof(line), format, args);
+	if (length < 0)
+		length = 0;
+	if (length < (int)sizeof(line))
+		logSink().append(line, length);
+	else
+	{
+		string longLine(length + 1, '\0');
+		vsnprintf(&longLine[0], longLine.size(), format, again);
+		logSink().append(longLine.data(), length);
+	}
+	va_end(again);
+}
+
+//printf-style message at a level; compiled out above LOG_COMPILED_LEVEL
+template <logLevel level>
+inline void logPrintf(const char* format, ...)
+{
+	if constexpr (logCompiled<level>())
+	{
+		if (level > logVerbosity)
+			return;
+		va_list args;
+		va_start(args, format);
+		logWrite(format, args);
+		va_end(args);
+	}
+}
+
+#endif
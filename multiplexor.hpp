@@ -1,24 +1,57 @@
+#ifndef MULTIPLEXOR_HPP
+#define MULTIPLEXOR_HPP
+
 #include <algorithm>
 #include "allocate_reg.hpp"
 
+//One pass over each binding; unit ordinals count per operation type in
+//opResources order, matching the FU<type>_<ordinal> names in the netlist.
+void buildBindingIndex(synthesisContext& ctx)
+{
+	bindingIndex& b = ctx.binding;
+	vector<int> unitsOfType(ctx.opTypes.size(), 0);
+
+	b.regClique.assign(ctx.registers.size(), -1);
+	for (int i = 0; i < ctx.regResources.size(); i++)
+		for (int k = 0; k < ctx.regResources[i].size(); k++)
+			b.regClique[ctx.regResources[i][k]] = i;
+
+	b.opUnit.assign(ctx.operations.size(), -1);
+	b.unitOrdinal.resize(ctx.opResources.size());
+	for (int i = 0; i < ctx.opResources.size(); i++)
+	{
+		for (int k = 0; k < ctx.opResources[i].clique.size(); k++)
+			b.opUnit[ctx.opResources[i].clique[k]] = i;
+		b.unitOrdinal[i] = unitsOfType[ctx.operations[ctx.opResources[i].clique[0]].typeId]++;
+	}
 
-void allocateMultiplexers()
+	b.regMux.assign(ctx.regResources.size(), -1);
+	for (int i = 0; i < ctx.muxResources.size(); i++)
+		if (ctx.muxResources[i].resourceBoundTo == "REG")
+			b.regMux[ctx.muxResources[i].resourceIndex] = i;
+}
+
+void allocateMultiplexers(synthesisContext& ctx)
 {
-	for (int i = 0; i < regResources.size(); i++)
-		if (regResources[i].size() > 1)
+	for (int i = 0; i < ctx.regResources.size(); i++)
+		if (ctx.regResources[i].size() > 1)
 		{
-			muxResources.push_back(mux());
-			muxResources.back().numInputs = regResources[i].size(); //clique size
-			muxResources.back().resourceBoundTo = "REG";
-			muxResources.back().resourceIndex = i;
+			ctx.muxResources.push_back(mux());
+			ctx.muxResources.back().numInputs = ctx.regResources[i].size(); //clique size
+			ctx.muxResources.back().resourceBoundTo = "REG";
+			ctx.muxResources.back().resourceIndex = i;
 		}
 
-	for (int i = 0; i < opResources.size(); i++)
-		if (opResources[i].clique.size() > 1)
+	for (int i = 0; i < ctx.opResources.size(); i++)
+		if (ctx.opResources[i].clique.size() > 1)
 		{
-			muxResources.push_back(mux());
-			muxResources.back().numInputs = opResources[i].clique.size(); //num items in clique
-			muxResources.back().resourceBoundTo = opResources[i].type;
-			muxResources.back().resourceIndex = i;
+			ctx.muxResources.push_back(mux());
+			ctx.muxResources.back().numInputs = ctx.opResources[i].clique.size(); //num items in clique
+			ctx.muxResources.back().resourceBoundTo = ctx.opResources[i].type;
+			ctx.muxResources.back().resourceIndex = i;
 		}
+
+	buildBindingIndex(ctx);
 }
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "scheduler.hpp"
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+//Instrumentation behind --profile=file.json.
+//
+//A design is profiled when its context points at a designProfile. The
+//stage timers test that pointer and do nothing else when it is NULL, so an
+//unprofiled run pays one branch per stage. The partitioner keeps its own
+//counters either way (clique_stats, a few adds per merge step) and they are
+//copied out together with the design's size and arena use once the design
+//is done. The report is one JSON object for the whole run:
+//
+//	{ "threads": T, "wall_ms": W, "peak_rss_kb": R, "designs": [
+//	    { "input": ..., "output": ..., "status": 0, "total_ms": ...,
+//	      "operations": ..., "registers": ..., "functional_units": ...,
+//	      "register_cliques": ..., "multiplexers": ...,
+//	      "stages_ms": { "read": ..., ..., "write": ... },
+//	      "arena": { "peak_bytes": ..., "reserved_bytes": ... },
+//	      "partitioner": { "fu": {...} or null, "reg": {...} or null } }, ... ] }
+//
+//Stages that did not run (a design that failed early) are null.
+
+enum profileStage { PROFILE_READ, PROFILE_SCHEDULE, PROFILE_FU_BIND, PROFILE_REG_BIND, PROFILE_MUX, PROFILE_WRITE, NUM_PROFILE_STAGES };
+const char* profileStageNames[NUM_PROFILE_STAGES] = { "read", "schedule", "fu_bind", "reg_bind", "mux", "write" };
+
+struct designProfile {
+	string input, output;
+	int status;
+	double totalMs;
+	double stageMs[NUM_PROFILE_STAGES]; //-1 if the stage did not run
+	int operations, registers, functionalUnits, registerCliques, multiplexers;
+	clique_stats fuPartition, regPartition;
+	size_t arenaPeak, arenaReserved;
+
+	designProfile() : status(0), totalMs(0), operations(0), registers(0), functionalUnits(0),
+		registerCliques(0), multiplexers(0), fuPartition(), regPartition(), arenaPeak(0), arenaReserved(0)
+	{
+		for (int s = 0; s < NUM_PROFILE_STAGES; s++)
+			stageMs[s] = -1;
+	}
+};
+
+//times its scope as one stage of ctx's design, when that design is profiled
+struct stageTimer {
+	designProfile* profile;
+	profileStage stage;
+	chrono::steady_clock::time_point start;
+
+	stageTimer(synthesisContext& ctx, profileStage s) : profile(ctx.profile), stage(s)
+	{
+		if (profile != NULL)
+			start = chrono::steady_clock::now();
+	}
+
+	~stageTimer()
+	{
+		if (profile != NULL)
+			profile->stageMs[stage] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+};
+
+//size, partitioner counters and arena use of ctx's finished design
+void recordDesign(synthesisContext& ctx)
+{
+	designProfile* p = ctx.profile;
+
+	if (p == NULL)
+		return;
+	p->operations = ctx.operations.size();
+	p->registers = ctx.registers.size();
+	p->functionalUnits = ctx.opResources.size();
+	p->registerCliques = ctx.regResources.size();
+	p->multiplexers = ctx.muxResources.size();
+	p->fuPartition = ctx.fuPartition;
+	p->regPartition = ctx.regPartition;
+	p->arenaPeak = ctx.synthArena.peak + ctx.regArena.peak; //the binders may overlap
+	p->arenaReserved = ctx.synthArena.reserved + ctx.regArena.reserved;
+}
+
+long peakRSSkB() //of the whole process, -1 where unknown
+{
+#if defined(_WIN32)
+	return -1;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return usage.ru_maxrss / 1024; //bytes there
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+string jsonString(const string& s)
+{
+	string quoted = "\"";
+	char escape[8];
+
+	for (int i = 0; i < s.size(); i++)
+	{
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\')
+		{
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (c < 0x20)
+		{
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			quoted += escape;
+		}
+		else
+			quoted += c;
+	}
+	return quoted + "\"";
+}
+
+string jsonPartition(const clique_stats& s) //null if the partitioner did not run
+{
+	char text[384];
+
+	if (s.nodes == 0)
+		return "null";
+	snprintf(text, sizeof(text), "{ \"nodes\": %ld, \"cliques\": %ld, \"merge_steps\": %ld, "
+		"\"candidate_evaluations\": %ld, \"max_set_y\": %ld, \"tied_candidates\": %ld, \"starts\": %ld, \"best_start\": %ld }",
+		s.nodes, s.cliques, s.merge_steps, s.candidate_evaluations, s.max_setY, s.tied_candidates, s.starts, s.best_start);
+	return text;
+}
+
+bool writeProfile(const string& path, const vector<designProfile>& designs, int threads, double wallMs)
+{
+	ofstream out(path.c_str());
+	char number[32];
+
+	if (!out)
+		return false;
+
+	snprintf(number, sizeof(number), "%.3f", wallMs);
+	out << "{\n  \"threads\": " << threads << ",\n  \"wall_ms\": " << number
+		<< ",\n  \"peak_rss_kb\": " << peakRSSkB() << ",\n  \"designs\": [";
+
+	for (int i = 0; i < designs.size(); i++)
+	{
+		const designProfile& d = designs[i];
+
+		snprintf(number, sizeof(number), "%.3f", d.totalMs);
+		out << (i == 0 ? "\n" : ",\n") << "    {\n";
+		out << "      \"input\": " << jsonString(d.input) << ",\n";
+		out << "      \"output\": " << jsonString(d.output) << ",\n";
+		out << "      \"status\": " << d.status << ",\n";
+		out << "      \"total_ms\": " << number << ",\n";
+		out << "      \"operations\": " << d.operations << ",\n";
+		out << "      \"registers\": " << d.registers << ",\n";
+		out << "      \"functional_units\": " << d.functionalUnits << ",\n";
+		out << "      \"register_cliques\": " << d.registerCliques << ",\n";
+		out << "      \"multiplexers\": " << d.multiplexers << ",\n";
+
+		out << "      \"stages_ms\": {";
+		for (int s = 0; s < NUM_PROFILE_STAGES; s++)
+		{
+			if (d.stageMs[s] < 0)
+				snprintf(number, sizeof(number), "null");
+			else
+				snprintf(number, sizeof(number), "%.3f", d.stageMs[s]);
+			out << (s == 0 ? " " : ", ") << "\"" << profileStageNames[s] << "\": " << number;
+		}
+		out << " },\n";
+
+		out << "      \"arena\": { \"peak_bytes\": " << d.arenaPeak << ", \"reserved_bytes\": " << d.arenaReserved << " },\n";
+		out << "      \"partitioner\": { \"fu\": " << jsonPartition(d.fuPartition)
+			<< ", \"reg\": " << jsonPartition(d.regPartition) << " }\n";
+		out << "    }";
+	}
+	out << "\n  ]\n}\n";
+	return (bool)out;
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -5,18 +8,98 @@
 #include <vector>
 #include <math.h>
 #include <algorithm>
+#include <unordered_map>
+#include <queue>
+#include <string_view>
+#include <stdint.h>
 #include "clique_partition.h"
+#include "thread_pool.hpp"
+
+using namespace std;
+
+//Open-addressing index from a name to its position in a table of names.
+//A slot packs the upper half of the name's hash with id + 1 (0 is empty),
+//so a probe only looks at the table's string when the hashes agree, and
+//the names themselves are stored once, in the table.
+struct nameIndex {
+	vector<uint64_t> slots;
+	size_t count;
+
+	nameIndex() : count(0) {}
+
+	static uint32_t hash(string_view name) //FNV-1a, upper half
+	{
+		uint64_t h = 14695981039346656037ULL;
+		for (size_t k = 0; k < name.size(); k++)
+			h = (h ^ (unsigned char)name[k]) * 1099511628211ULL;
+		return (uint32_t)(h >> 32);
+	}
+
+	template <class NameOf>
+	int find(string_view name, uint32_t h, NameOf nameOf) const
+	{
+		if (slots.empty())
+			return -1;
+		size_t mask = slots.size() - 1;
+		for (size_t k = h & mask; slots[k] != 0; k = (k + 1) & mask)
+			if ((uint32_t)(slots[k] >> 32) == h && nameOf((int)(uint32_t)slots[k] - 1) == name)
+				return (int)(uint32_t)slots[k] - 1;
+		return -1;
+	}
+
+	void insert(uint32_t h, int id) //id must not be present yet
+	{
+		if (2 * (count + 1) > slots.size())
+		{
+			vector<uint64_t> old;
+			old.swap(slots);
+			slots.assign(old.empty() ? 64 : 2 * old.size(), 0);
+			count = 0;
+			for (size_t k = 0; k < old.size(); k++)
+				if (old[k] != 0)
+					place(old[k]);
+		}
+		place(((uint64_t)h << 32) | (uint32_t)(id + 1));
+	}
+
+	void place(uint64_t slot)
+	{
+		size_t mask = slots.size() - 1;
+		size_t k = (slot >> 32) & mask;
+		while (slots[k] != 0)
+			k = (k + 1) & mask;
+		slots[k] = slot;
+		count++;
+	}
+
+	void clear()
+	{
+		slots.clear();
+		count = 0;
+	}
+};
+
+struct symbol { //a signal name, interned once by the parser
+	string name;
+	int producer; //operation that writes it, -1 if none (inputs)
+	vector<int> consumers; //operations that read it, in operation order
+	int reg; //index into registers, -1 if it has no register
+	int width; //declared bit width, 0 if never declared
+	bool isInput;
+};
 
 struct operation {
 	string type;
-	string operand1;
-	string operand2;
-	string output;
+	int typeId; //index into opTypes
+	int width; //bit width
+	int operand1; //symbol ids
+	int operand2;
+	int output;
 	int timestep;
 };
 
 struct reg {
-	string name;
+	int symbolId; //symbol held in this register
 	int first; //first timestep accessed
 	int last; //last timestep accessed
 };
@@ -31,38 +114,563 @@ struct mux {
 	string resourceBoundTo;
 	int resourceIndex;
 };
-vector<string> inputs, outputs;
-vector<operation> operations;
-vector<reg> registers;
-vector<resource> opResources;
-vector<vector<int> > regResources;
-vector<mux> muxResources;
-int inputBits = 0, outputBits = 0, registerBits = 0, operationBits = 0;
-int** regCompGraph, **funcCompGraph;
-
-void createASAP()
+
+//The bindings looked up from the other side, so the netlist writer never
+//searches them. Filled by buildBindingIndex() once all resources are allocated.
+struct bindingIndex {
+	vector<int> regClique; //register -> regResources index
+	vector<int> opUnit; //operation -> opResources index
+	vector<int> unitOrdinal; //opResources index -> its number among the units of its type
+	vector<int> regMux; //regResources index -> muxResources index feeding it, -1 if none
+
+	void clear()
+	{
+		regClique.clear();
+		opUnit.clear();
+		unitOrdinal.clear();
+		regMux.clear();
+	}
+};
+
+struct designProfile; //profile.hpp
+
+//Everything one design's synthesis reads and writes. Every stage takes the
+//context it works on, so independent designs can be synthesized at the
+//same time on different threads, each with its own context. The options
+//below (schedulers, binders, limits) are set once from the command line
+//and only read afterwards.
+struct synthesisContext {
+	vector<symbol> symbols;
+	nameIndex symbolIds; //name -> index into symbols
+	vector<string> opTypes;
+	nameIndex opTypeIds; //type -> index into opTypes
+	vector<int> inputs, outputs; //symbol ids
+	vector<operation> operations;
+	vector<reg> registers;
+	vector<resource> opResources;
+	vector<vector<int> > regResources;
+	vector<mux> muxResources;
+	bindingIndex binding;
+	int inputBits, outputBits, registerBits, operationBits; //widest of each kind
+	compat_matrix regCompGraph, funcCompGraph;
+	synth_arena synthArena; //backs funcCompGraph and its partitioner run, reset between designs
+	synth_arena regArena; //same for regCompGraph, so the two binders can run at once
+	clique_stats fuPartition, regPartition; //the binders' partitioner counters, zero if they did not run
+	ostream* report; //where the stages print their results and errors
+	workStealingPool* pool; //lets large stages split into tasks, NULL runs them serially
+	designProfile* profile; //stage timings go here when profiling, NULL otherwise
+
+	synthesisContext() : inputBits(0), outputBits(0), registerBits(0), operationBits(0),
+		regCompGraph(), funcCompGraph(), synthArena(), regArena(), fuPartition(), regPartition(), report(&cout), pool(NULL), profile(NULL) {}
+	~synthesisContext() { arena_release(&synthArena); arena_release(&regArena); }
+
+	synthesisContext(const synthesisContext&) = delete; //owns its arenas' chunks
+	synthesisContext& operator=(const synthesisContext&) = delete;
+};
+
+enum opScheduler { SCHED_ASAP, SCHED_LIST, SCHED_FORCE };
+opScheduler operationScheduler = SCHED_ASAP; //how scheduleOperations() assigns timesteps
+unordered_map<string, int> fuLimits; //op type -> units the list scheduler may use per timestep
+int latencyBound = 0; //timesteps the force-directed scheduler may use
+
+int internSymbol(synthesisContext& ctx, string_view name) //id of name, added to the table the first time it is seen
+{
+	uint32_t h = nameIndex::hash(name);
+	int id = ctx.symbolIds.find(name, h, [&ctx](int i) -> const string& { return ctx.symbols[i].name; });
+	if (id != -1)
+		return id;
+
+	ctx.symbols.push_back(symbol());
+	ctx.symbols.back().name = string(name);
+	ctx.symbols.back().producer = -1;
+	ctx.symbols.back().reg = -1;
+	ctx.symbols.back().width = 0;
+	ctx.symbols.back().isInput = false;
+	ctx.symbolIds.insert(h, ctx.symbols.size() - 1);
+	return ctx.symbols.size() - 1;
+}
+
+int internOpType(synthesisContext& ctx, string_view type)
+{
+	uint32_t h = nameIndex::hash(type);
+	int id = ctx.opTypeIds.find(type, h, [&ctx](int i) -> const string& { return ctx.opTypes[i]; });
+	if (id != -1)
+		return id;
+
+	ctx.opTypes.push_back(string(type));
+	ctx.opTypeIds.insert(h, ctx.opTypes.size() - 1);
+	return ctx.opTypes.size() - 1;
+}
+
+int findOpType(synthesisContext& ctx, string_view type) //-1 if no operation has this type
+{
+	return ctx.opTypeIds.find(type, nameIndex::hash(type), [&ctx](int i) -> const string& { return ctx.opTypes[i]; });
+}
+
+void resetDesign(synthesisContext& ctx) //forget the current design so the next one starts from empty tables
+{
+	ctx.symbols.clear();
+	ctx.symbolIds.clear();
+	ctx.opTypes.clear();
+	ctx.opTypeIds.clear();
+	ctx.inputs.clear();
+	ctx.outputs.clear();
+	ctx.operations.clear();
+	ctx.registers.clear();
+	ctx.opResources.clear();
+	ctx.regResources.clear();
+	ctx.muxResources.clear();
+	ctx.binding.clear();
+	ctx.fuPartition = clique_stats();
+	ctx.regPartition = clique_stats();
+	ctx.inputBits = ctx.outputBits = ctx.registerBits = ctx.operationBits = 0;
+	ctx.regCompGraph = compat_matrix();
+	ctx.funcCompGraph = compat_matrix();
+	arena_reset(&ctx.synthArena); //comp graphs and partitioner scratch go with it
+	arena_reset(&ctx.regArena);
+}
+
+void buildDefUse(synthesisContext& ctx) //producer and consumer lists of every symbol, once operations are read
+{
+	for (int i = 0; i < ctx.symbols.size(); i++)
+	{
+		ctx.symbols[i].producer = -1;
+		ctx.symbols[i].consumers.clear();
+	}
+
+	for (int i = 0; i < ctx.inputs.size(); i++)
+		ctx.symbols[ctx.inputs[i]].isInput = true;
+
+	for (int i = 0; i < ctx.operations.size(); i++)
+	{
+		ctx.symbols[ctx.operations[i].operand1].consumers.push_back(i);
+		if (ctx.operations[i].operand2 != ctx.operations[i].operand1)
+			ctx.symbols[ctx.operations[i].operand2].consumers.push_back(i);
+		ctx.symbols[ctx.operations[i].output].producer = i; //last writer wins, as with a name search
+	}
+}
+
+bool createASAP(synthesisContext& ctx) //worklist ASAP over the def-use lists; false if some operation can never run
+{
+	int timestep = 0, operationsScheduled = 0;
+	vector<bool> available(ctx.symbols.size(), false); //symbols produced so far
+	vector<int> waitingOn(ctx.operations.size(), 0); //distinct operands not yet available
+	vector<int> ready, next;
+
+	for (int i = 0; i < ctx.inputs.size(); i++)
+		available[ctx.inputs[i]] = true;
+
+	for (int i = 0; i < ctx.operations.size(); i++)
+	{
+		ctx.operations[i].timestep = 0;
+		if (!available[ctx.operations[i].operand1])
+			waitingOn[i]++;
+		if (ctx.operations[i].operand2 != ctx.operations[i].operand1 && !available[ctx.operations[i].operand2])
+			waitingOn[i]++;
+		if (waitingOn[i] == 0)
+			ready.push_back(i);
+	}
+
+	while (!ready.empty()) //everything in ready runs in the current timestep
+	{
+		timestep++;
+		next.clear();
+
+		for (int i = 0; i < ready.size(); i++)
+		{
+			ctx.operations[ready[i]].timestep = timestep;
+			operationsScheduled++;
+		}
+
+		for (int i = 0; i < ready.size(); i++) //outputs become available to the next timestep
+		{
+			int output = ctx.operations[ready[i]].output;
+			if (available[output])
+				continue; //already written by an earlier operation
+			available[output] = true;
+
+			for (int k = 0; k < ctx.symbols[output].consumers.size(); k++)
+				if (--waitingOn[ctx.symbols[output].consumers[k]] == 0)
+					next.push_back(ctx.symbols[output].consumers[k]);
+		}
+		ready.swap(next);
+	}
+
+	if (operationsScheduled == ctx.operations.size())
+		return true;
+
+	vector<int> blockedBy(ctx.operations.size(), -1); //undefined symbol each stuck operation waits on
+	vector<int> worklist;
+
+	for (int i = 0; i < ctx.operations.size(); i++) //operations reading a symbol nobody produces
+	{
+		if (ctx.operations[i].timestep != 0)
+			continue;
+		if (!available[ctx.operations[i].operand1] && ctx.symbols[ctx.operations[i].operand1].producer == -1)
+			blockedBy[i] = ctx.operations[i].operand1;
+		else if (!available[ctx.operations[i].operand2] && ctx.symbols[ctx.operations[i].operand2].producer == -1)
+			blockedBy[i] = ctx.operations[i].operand2;
+		if (blockedBy[i] != -1)
+			worklist.push_back(i);
+	}
+
+	while (!worklist.empty()) //and everything downstream of them
+	{
+		int op = worklist.back(), output = ctx.operations[op].output;
+		worklist.pop_back();
+		for (int k = 0; k < ctx.symbols[output].consumers.size(); k++)
+		{
+			int consumer = ctx.symbols[output].consumers[k];
+			if (ctx.operations[consumer].timestep == 0 && blockedBy[consumer] == -1)
+			{
+				blockedBy[consumer] = blockedBy[op];
+				worklist.push_back(consumer);
+			}
+		}
+	}
+
+	for (int i = 0; i < ctx.operations.size(); i++) //report what could not be scheduled
+	{
+		if (ctx.operations[i].timestep != 0)
+			continue;
+
+		*ctx.report << "Error: op" << i + 1 << " " << ctx.operations[i].type << " " << ctx.symbols[ctx.operations[i].operand1].name
+			<< " " << ctx.symbols[ctx.operations[i].operand2].name << " " << ctx.symbols[ctx.operations[i].output].name << " ";
+		if (blockedBy[i] != -1)
+			*ctx.report << "is unreachable: " << ctx.symbols[blockedBy[i]].name << " is neither an input nor produced by any operation" << endl;
+		else
+			*ctx.report << "is on or behind a dependency cycle" << endl;
+	}
+	return false;
+}
+
+//Resource-constrained list scheduling. Ready operations wait in a priority
+//queue per type, highest first by the length of the longest dependence path
+//from them to the end of the graph (least ALAP slack), then by lowest index.
+//Each timestep issues at most fuLimits[type] operations of a type; types
+//without a limit are unconstrained, and a limit on a type the design does not
+//use is reported, since it is most likely a misspelt type. The ASAP pass runs
+//first, both to reject graphs that cannot be scheduled and to order the path
+//length computation.
+bool createListSchedule(synthesisContext& ctx)
 {
-	int operationsToSchedule = operations.size(), timestep = 0, operationIndex;
-	vector<string> scheduled = inputs;
-	vector<int> toSchedule;
+	if (!createASAP(ctx))
+		return false;
+
+	int n = ctx.operations.size(), maxTimestep = 0;
+	vector<int> limit(ctx.opTypes.size(), n); //per type, n is unconstrained
+
+	for (unordered_map<string, int>::iterator it = fuLimits.begin(); it != fuLimits.end(); ++it)
+		if (findOpType(ctx, it->first) != -1)
+			limit[findOpType(ctx, it->first)] = it->second;
+		else if (logEnabled<LOG_WARN>())
+			*ctx.report << "Warning: --fu-limits names type " << it->first << ", which no operation in this design uses" << endl;
+
+	//longest path to a sink, visiting operations latest ASAP timestep first
+	for (int i = 0; i < n; i++)
+		if (ctx.operations[i].timestep > maxTimestep)
+			maxTimestep = ctx.operations[i].timestep;
+
+	vector<int> byStep(maxTimestep + 2, 0), order(n), pathLength(n, 1);
+	for (int i = 0; i < n; i++)
+		byStep[ctx.operations[i].timestep + 1]++;
+	for (int t = 1; t <= maxTimestep + 1; t++)
+		byStep[t] += byStep[t - 1];
+	for (int i = 0; i < n; i++)
+		order[byStep[ctx.operations[i].timestep]++] = i;
+
+	for (int k = n - 1; k >= 0; k--)
+	{
+		int i = order[k], output = ctx.operations[i].output;
+		for (int c = 0; c < ctx.symbols[output].consumers.size(); c++)
+		{
+			int consumer = ctx.symbols[output].consumers[c];
+			if (ctx.operations[consumer].timestep > ctx.operations[i].timestep && pathLength[consumer] + 1 > pathLength[i])
+				pathLength[i] = pathLength[consumer] + 1;
+		}
+	}
 
-	while (operationsToSchedule != 0)
+	//same readiness bookkeeping as createASAP(), with a bounded issue width
+	typedef pair<int, int> priority; //(path length, -operation index)
+	vector<priority_queue<priority> > ready(ctx.opTypes.size());
+	vector<bool> available(ctx.symbols.size(), false);
+	vector<int> waitingOn(n, 0), issued;
+	int timestep = 0, operationsScheduled = 0;
+
+	for (int i = 0; i < ctx.inputs.size(); i++)
+		available[ctx.inputs[i]] = true;
+
+	for (int i = 0; i < n; i++)
+	{
+		ctx.operations[i].timestep = 0;
+		if (!available[ctx.operations[i].operand1])
+			waitingOn[i]++;
+		if (ctx.operations[i].operand2 != ctx.operations[i].operand1 && !available[ctx.operations[i].operand2])
+			waitingOn[i]++;
+		if (waitingOn[i] == 0)
+			ready[ctx.operations[i].typeId].push(priority(pathLength[i], -i));
+	}
+
+	while (operationsScheduled < n)
 	{
 		timestep++;
+		issued.clear();
+
+		for (int type = 0; type < ctx.opTypes.size(); type++)
+			for (int k = 0; k < limit[type] && !ready[type].empty(); k++)
+			{
+				int i = -ready[type].top().second;
+				ready[type].pop();
+				ctx.operations[i].timestep = timestep;
+				issued.push_back(i);
+			}
+		operationsScheduled += issued.size();
+
+		for (int k = 0; k < issued.size(); k++) //outputs become available to the next timestep
+		{
+			int output = ctx.operations[issued[k]].output;
+			if (available[output])
+				continue;
+			available[output] = true;
+
+			for (int c = 0; c < ctx.symbols[output].consumers.size(); c++)
+			{
+				int consumer = ctx.symbols[output].consumers[c];
+				if (--waitingOn[consumer] == 0)
+					ready[ctx.operations[consumer].typeId].push(priority(pathLength[consumer], -consumer));
+			}
+		}
+	}
+	return true;
+}
+
+//Force-directed scheduling (Paulin and Knight) under the latency bound.
+//Every operation has a frame [asap, alap] and adds 1/width to the
+//distribution graph of its type at every timestep of the frame. Operations
+//are fixed one at a time, least mobile first, at the timestep of lowest
+//force: the self force plus the change it causes in the frames of its direct
+//predecessors and successors. Fixing an operation narrows the frames
+//downstream and upstream of it; only the operations whose frame actually
+//changes are taken out of and put back into the distribution graphs, so the
+//graphs are never rebuilt. The graphs are Fenwick trees with range add and
+//range sum, so a frame update or a frame average costs O(log L) however wide
+//the frame is.
+struct distributionGraph {
+	vector<double> slope, offset; //two Fenwick trees over timesteps 1..L
+
+	void init(int latency)
+	{
+		slope.assign(latency + 1, 0.0);
+		offset.assign(latency + 1, 0.0);
+	}
+
+	void update(vector<double>& tree, int t, double v)
+	{
+		for (; t < tree.size(); t += t & -t)
+			tree[t] += v;
+	}
+
+	double query(const vector<double>& tree, int t) const
+	{
+		double sum = 0;
+		for (; t > 0; t -= t & -t)
+			sum += tree[t];
+		return sum;
+	}
+
+	double prefix(int t) const //sum of the graph over [1, t]
+	{
+		return query(slope, t) * t - query(offset, t);
+	}
+
+	void add(int first, int last, double v) //graph[t] += v for t in [first, last]
+	{
+		update(slope, first, v);
+		update(slope, last + 1, -v);
+		update(offset, first, v * (first - 1));
+		update(offset, last + 1, -v * last);
+	}
+
+	double average(int first, int last) const //mean of the graph over [first, last]
+	{
+		return (prefix(last) - prefix(first - 1)) / (last - first + 1);
+	}
+};
+
+struct forceFrames {
+	vector<int> asap, alap;
+	vector<distributionGraph> dg; //one per op type
+};
+
+void addToDistribution(synthesisContext& ctx, forceFrames& f, int op, double sign)
+{
+	f.dg[ctx.operations[op].typeId].add(f.asap[op], f.alap[op], sign / (f.alap[op] - f.asap[op] + 1));
+}
+
+//change in the distribution-graph average seen by op if its frame became [first, last]
+double frameForce(synthesisContext& ctx, const forceFrames& f, int op, int first, int last)
+{
+	const distributionGraph& dg = f.dg[ctx.operations[op].typeId];
+	if (first == f.asap[op] && last == f.alap[op])
+		return 0;
+	return dg.average(first, last) - dg.average(f.asap[op], f.alap[op]);
+}
+
+bool createForceDirectedSchedule(synthesisContext& ctx)
+{
+	if (!createASAP(ctx))
+		return false;
+
+	int n = ctx.operations.size(), criticalPath = 0;
+	for (int i = 0; i < n; i++)
+		if (ctx.operations[i].timestep > criticalPath)
+			criticalPath = ctx.operations[i].timestep;
+
+	if (latencyBound < criticalPath)
+	{
+		*ctx.report << "Error: latency bound " << latencyBound << " is shorter than the critical path ("
+			<< criticalPath << " timesteps)" << endl;
+		return false;
+	}
+
+	//dependence edges: an operand comes from the operation that first makes it available
+	vector<int> source(ctx.symbols.size(), -1);
+	vector<vector<int> > preds(n), succs(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		int output = ctx.operations[i].output;
+		if (!ctx.symbols[output].isInput &&
+			(source[output] == -1 || ctx.operations[i].timestep < ctx.operations[source[output]].timestep))
+			source[output] = i;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		int a = source[ctx.operations[i].operand1], b = source[ctx.operations[i].operand2];
+		if (a != -1)
+			preds[i].push_back(a);
+		if (b != -1 && b != a)
+			preds[i].push_back(b);
+		for (int k = 0; k < preds[i].size(); k++)
+			succs[preds[i][k]].push_back(i);
+	}
 
-		for (int i = 0; i < operations.size(); i++) //find operations in current timestep
-			if (operations[i].timestep == 0)
-				if ((find(scheduled.begin(), scheduled.end(), operations[i].operand1) != scheduled.end()) && // if both operands are in the scheduled vector,
-					(find(scheduled.begin(), scheduled.end(), operations[i].operand2) != scheduled.end()))  // we can run this in the first timestep.
-					toSchedule.push_back(i);
+	forceFrames f;
+	vector<int> order(n);
+	f.asap.resize(n);
+	f.alap.assign(n, latencyBound);
+	f.dg.resize(ctx.opTypes.size());
+	for (int type = 0; type < ctx.opTypes.size(); type++)
+		f.dg[type].init(latencyBound + 1); //room for the update one past the last timestep
 
-		while (!toSchedule.empty()) //once all operations that can be scheduled are found:
+	for (int i = 0; i < n; i++)
+	{
+		f.asap[i] = ctx.operations[i].timestep;
+		order[i] = i;
+	}
+
+	//ALAP frames, latest ASAP timestep first so successors are final before their predecessors
+	sort(order.begin(), order.end(), [&](int a, int b) { return f.asap[a] > f.asap[b]; });
+	for (int k = 0; k < n; k++)
+		for (int j = 0; j < succs[order[k]].size(); j++)
+			f.alap[order[k]] = min(f.alap[order[k]], f.alap[succs[order[k]][j]] - 1);
+
+	for (int i = 0; i < n; i++)
+		addToDistribution(ctx, f, i, 1.0);
+
+	//least mobile first, then earliest, then by index
+	sort(order.begin(), order.end(), [&](int a, int b) {
+		int ma = f.alap[a] - f.asap[a], mb = f.alap[b] - f.asap[b];
+		if (ma != mb) return ma < mb;
+		if (f.asap[a] != f.asap[b]) return f.asap[a] < f.asap[b];
+		return a < b;
+	});
+
+	vector<int> worklist;
+
+	for (int k = 0; k < n; k++)
+	{
+		int i = order[k], best = f.asap[i];
+		double bestForce = 0;
+
+		if (f.asap[i] != f.alap[i])
+		{
+			const distributionGraph& dg = f.dg[ctx.operations[i].typeId];
+			double average = dg.average(f.asap[i], f.alap[i]);
+
+			for (int t = f.asap[i]; t <= f.alap[i]; t++)
+			{
+				double force = dg.average(t, t) - average;
+				for (int j = 0; j < preds[i].size(); j++)
+				{
+					int p = preds[i][j];
+					force += frameForce(ctx, f, p, f.asap[p], min(f.alap[p], t - 1));
+				}
+				for (int j = 0; j < succs[i].size(); j++)
+				{
+					int s = succs[i][j];
+					force += frameForce(ctx, f, s, max(f.asap[s], t + 1), f.alap[s]);
+				}
+				if (t == f.asap[i] || force < bestForce - 1e-9)
+				{
+					best = t;
+					bestForce = force;
+				}
+			}
+		}
+
+		//fix i at best, then narrow the frames it constrains
+		addToDistribution(ctx, f, i, -1.0);
+		f.asap[i] = f.alap[i] = best;
+		addToDistribution(ctx, f, i, 1.0);
+
+		worklist.push_back(i);
+		while (!worklist.empty())
+		{
+			int op = worklist.back();
+			worklist.pop_back();
+			for (int j = 0; j < succs[op].size(); j++)
+			{
+				int s = succs[op][j];
+				if (f.asap[s] > f.asap[op])
+					continue;
+				addToDistribution(ctx, f, s, -1.0);
+				f.asap[s] = f.asap[op] + 1;
+				addToDistribution(ctx, f, s, 1.0);
+				worklist.push_back(s);
+			}
+		}
+
+		worklist.push_back(i);
+		while (!worklist.empty())
 		{
-			operationIndex = toSchedule.back();
-			toSchedule.pop_back();
-			operations[operationIndex].timestep = timestep; //update each operation with its timestep
-			scheduled.push_back(operations[operationIndex].output); //add each operation that is now scheduled to the scheduled vector
-			operationsToSchedule--; //update # of operations left to be assigned a timestep
+			int op = worklist.back();
+			worklist.pop_back();
+			for (int j = 0; j < preds[op].size(); j++)
+			{
+				int p = preds[op][j];
+				if (f.alap[p] < f.alap[op])
+					continue;
+				addToDistribution(ctx, f, p, -1.0);
+				f.alap[p] = f.alap[op] - 1;
+				addToDistribution(ctx, f, p, 1.0);
+				worklist.push_back(p);
+			}
 		}
 	}
+
+	for (int i = 0; i < n; i++)
+		ctx.operations[i].timestep = f.asap[i];
+	return true;
 }
+
+bool scheduleOperations(synthesisContext& ctx)
+{
+	if (operationScheduler == SCHED_FORCE)
+		return createForceDirectedSchedule(ctx);
+	if (operationScheduler == SCHED_LIST)
+		return createListSchedule(ctx);
+	return createASAP(ctx);
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef SYNTH_ARENA_H
+#define SYNTH_ARENA_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/****************************************************************************
+*  Synthesis-run arena.
+*
+*   o Memory comes from large chunks handed out with a bump pointer.
+*   o Blocks given back with arena_free() go to a free list for their size
+*     class (powers of two from 64 B to 1 MB) and are reused by the next
+*     allocation of that class; bigger blocks go to a first-fit list.
+*   o arena_reset() forgets every allocation in O(1): the chunks are kept
+*     and bumped again from the first one, so a batch of designs run
+*     through the same arena reaches a flat memory profile.
+*   o Every block is 64-byte aligned.
+*   o A NULL arena falls back to the system allocator, so low level code
+*     can be used with or without a run arena.
+****************************************************************************/
+
+#define ARENA_ALIGN 64
+#define ARENA_CHUNK_BYTES ((size_t)1 << 20)
+#define ARENA_MIN_CLASS_SHIFT 6                /* smallest class: 64 B */
+#define ARENA_NUM_CLASSES 15                   /* largest class: 1 MB */
+#define ARENA_LARGE_GRAIN ((size_t)1 << 16)    /* large blocks round to 64 KB */
+
+struct arena_chunk
+{
+	arena_chunk* next;
+	size_t size;                /* usable bytes at base */
+	char* base;
+};
+
+struct arena_free_block
+{
+	arena_free_block* next;
+	size_t size;                /* only used on the large list */
+};
+
+struct synth_arena
+{
+	arena_chunk* chunks;        /* every chunk ever obtained, in bump order */
+	arena_chunk* current;       /* chunk being bumped, NULL before first use */
+	size_t offset;              /* bump offset into current */
+	arena_free_block* pools[ARENA_NUM_CLASSES];
+	arena_free_block* large;    /* freed blocks above the largest class */
+	size_t in_use;              /* bytes handed out and not given back */
+	size_t peak;                /* high-water mark of in_use since the last reset */
+	size_t reserved;            /* bytes obtained from the system */
+};
+
+inline void* aligned_block_alloc(size_t bytes)
+{
+	void* p = NULL;
+
+	if (bytes == 0) bytes = ARENA_ALIGN;
+#if defined(_MSC_VER)
+	p = _aligned_malloc(bytes, ARENA_ALIGN);
+#else
+	if (posix_memalign(&p, ARENA_ALIGN, bytes) != 0) p = NULL;
+#endif
+	if (p == NULL)
+	{
+		printf("Out of memory allocating %lu bytes. Aborting..\n", (unsigned long)bytes);
+		exit(0);
+	}
+	return p;
+}
+
+inline void aligned_block_free(void* p)
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+/* size class of a request, or ARENA_NUM_CLASSES if it is a large block */
+inline int arena_size_class(size_t bytes)
+{
+	int cls = 0;
+	size_t cap = (size_t)1 << ARENA_MIN_CLASS_SHIFT;
+
+	while (cap < bytes && cls < ARENA_NUM_CLASSES)
+	{
+		cap <<= 1;
+		cls++;
+	}
+	return cls;
+}
+
+inline size_t arena_block_size(size_t bytes)
+{
+	int cls = arena_size_class(bytes);
+
+	if (cls < ARENA_NUM_CLASSES)
+		return (size_t)1 << (cls + ARENA_MIN_CLASS_SHIFT);
+	return (bytes + ARENA_LARGE_GRAIN - 1) / ARENA_LARGE_GRAIN * ARENA_LARGE_GRAIN;
+}
+
+inline void* arena_bump(synth_arena* a, size_t size)
+{
+	arena_chunk* c = NULL;
+	void* p = NULL;
+
+	if (a->current != NULL && a->offset + size <= a->current->size)
+	{
+		p = a->current->base + a->offset;
+		a->offset += size;
+		return p;
+	}
+
+	/* reuse the chunks kept by arena_reset() before asking the system */
+	c = (a->current != NULL) ? a->current->next : a->chunks;
+	while (c != NULL && c->size < size)
+		c = c->next;
+
+	if (c == NULL)
+	{
+		c = (arena_chunk*)malloc(sizeof(arena_chunk));
+		if (c == NULL)
+		{
+			printf("Out of memory allocating the synthesis arena. Aborting..\n");
+			exit(0);
+		}
+		c->size = (size > ARENA_CHUNK_BYTES) ? size : ARENA_CHUNK_BYTES;
+		c->base = (char*)aligned_block_alloc(c->size);
+		a->reserved += c->size;
+		if (a->current != NULL)
+		{
+			c->next = a->current->next;
+			a->current->next = c;
+		}
+		else
+		{
+			c->next = a->chunks;
+			a->chunks = c;
+		}
+	}
+
+	a->current = c;
+	a->offset = size;
+	return c->base;
+}
+
+inline void* arena_alloc(synth_arena* a, size_t bytes)
+{
+	size_t size = 0;
+	int cls = 0;
+	arena_free_block* b = NULL;
+	arena_free_block** link = NULL;
+	void* p = NULL;
+
+	if (a == NULL)
+		return aligned_block_alloc(bytes);
+
+	size = arena_block_size(bytes);
+	cls = arena_size_class(bytes);
+
+	if (cls < ARENA_NUM_CLASSES && a->pools[cls] != NULL)
+	{
+		b = a->pools[cls];
+		a->pools[cls] = b->next;
+		p = b;
+	}
+	else if (cls == ARENA_NUM_CLASSES)
+	{
+		for (link = &a->large; *link != NULL; link = &(*link)->next)
+		{
+			if ((*link)->size >= size)
+			{
+				b = *link;
+				*link = b->next;
+				if (b->size > size)
+				{
+					/* split; both parts stay multiples of the large grain */
+					arena_free_block* rest = (arena_free_block*)((char*)b + size);
+					rest->size = b->size - size;
+					rest->next = a->large;
+					a->large = rest;
+				}
+				p = b;
+				break;
+			}
+		}
+	}
+
+	if (p == NULL)
+		p = arena_bump(a, size);
+
+	a->in_use += size;
+	if (a->in_use > a->peak)
+		a->peak = a->in_use;
+	return p;
+}
+
+inline void arena_free(synth_arena* a, void* p, size_t bytes)
+{
+	arena_free_block* b = (arena_free_block*)p;
+	int cls = 0;
+
+	if (p == NULL)
+		return;
+	if (a == NULL)
+	{
+		aligned_block_free(p);
+		return;
+	}
+
+	cls = arena_size_class(bytes);
+	if (cls < ARENA_NUM_CLASSES)
+	{
+		b->next = a->pools[cls];
+		a->pools[cls] = b;
+		a->in_use -= (size_t)1 << (cls + ARENA_MIN_CLASS_SHIFT);
+	}
+	else
+	{
+		b->size = arena_block_size(bytes);
+		b->next = a->large;
+		a->large = b;
+		a->in_use -= b->size;
+	}
+}
+
+/* forget every allocation in O(1); the chunks are kept for reuse */
+inline void arena_reset(synth_arena* a)
+{
+	int cls = 0;
+
+	a->current = NULL;
+	a->offset = 0;
+	for (cls = 0; cls < ARENA_NUM_CLASSES; cls++)
+		a->pools[cls] = NULL;
+	a->large = NULL;
+	a->in_use = 0;
+	a->peak = 0;
+}
+
+/* give every chunk back to the system */
+inline void arena_release(synth_arena* a)
+{
+	arena_chunk* c = a->chunks;
+	arena_chunk* next = NULL;
+
+	while (c != NULL)
+	{
+		next = c->next;
+		aligned_block_free(c->base);
+		free(c);
+		c = next;
+	}
+	a->chunks = NULL;
+	a->reserved = 0;
+	arena_reset(a);
+}
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//Work-stealing thread pool.
+//
+//Every worker owns a deque. Tasks a worker submits go on the back of its
+//own deque and it takes work from the back (newest first, so nested
+//stage tasks stay hot in its cache); idle workers steal from the front of
+//the others' deques (oldest first, the biggest pieces). Tasks submitted
+//from outside the pool go through a FIFO injection queue, so a batch of
+//designs starts in submission order.
+//
+//Tasks are counted in a taskGroup and wait() returns once all of the
+//group's tasks have run. A worker that waits keeps running tasks of the
+//same group instead of blocking, so stages may split themselves into
+//finer tasks from inside a pool task without deadlocking the pool.
+
+struct taskGroup {
+	atomic<int> pending;
+	taskGroup() : pending(0) {}
+};
+
+struct poolTask {
+	function<void()> run;
+	taskGroup* group;
+};
+
+class workStealingPool {
+public:
+	explicit workStealingPool(int threads)
+		: queues(threads > 0 ? threads : 1), queued(0), stopping(false)
+	{
+		for (int i = 0; i < queues.size(); i++)
+			workers.push_back(thread(&workStealingPool::workerLoop, this, i));
+	}
+
+	~workStealingPool()
+	{
+		{
+			lock_guard<mutex> lock(sleepLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (int i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	int size() const { return workers.size(); }
+
+	void submit(taskGroup& group, function<void()> run)
+	{
+		poolTask task;
+		task.run = run;
+		task.group = &group;
+		group.pending++;
+
+		if (currentPool() == this)
+		{
+			lock_guard<mutex> lock(queues[currentWorker()].lock);
+			queues[currentWorker()].tasks.push_back(task);
+		}
+		else
+		{
+			lock_guard<mutex> lock(injectedLock);
+			injected.push_back(task);
+		}
+
+		{
+			lock_guard<mutex> lock(sleepLock);
+			queued++;
+		}
+		wake.notify_one();
+	}
+
+	void wait(taskGroup& group)
+	{
+		if (currentPool() != this) //outside the pool: just block
+		{
+			unique_lock<mutex> lock(doneLock);
+			done.wait(lock, [&group] { return group.pending == 0; });
+			return;
+		}
+
+		while (group.pending > 0) //inside: help with this group's tasks
+		{
+			poolTask task;
+			if (take(currentWorker(), task, &group))
+				execute(task);
+			else
+				this_thread::yield();
+		}
+	}
+
+private:
+	struct workerQueue {
+		mutex lock;
+		deque<poolTask> tasks;
+	};
+
+	vector<thread> workers;
+	vector<workerQueue> queues;
+	mutex injectedLock;
+	deque<poolTask> injected;
+
+	mutex sleepLock; //guards queued and stopping
+	condition_variable wake;
+	int queued;
+	bool stopping;
+
+	mutex doneLock;
+	condition_variable done;
+
+	static workStealingPool*& currentPool()
+	{
+		static thread_local workStealingPool* pool = NULL;
+		return pool;
+	}
+
+	static int& currentWorker()
+	{
+		static thread_local int worker = -1;
+		return worker;
+	}
+
+	//own deque from the back, then the other deques and the injection queue
+	//from the front; only tasks of group when group is given
+	bool take(int self, poolTask& task, taskGroup* group)
+	{
+		bool found = false;
+
+		{
+			lock_guard<mutex> lock(queues[self].lock);
+			deque<poolTask>& own = queues[self].tasks;
+			if (!own.empty() && (group == NULL || own.back().group == group))
+			{
+				task = own.back();
+				own.pop_back();
+				found = true;
+			}
+		}
+
+		for (int k = 1; !found && k < queues.size(); k++)
+		{
+			workerQueue& victim = queues[(self + k) % queues.size()];
+			lock_guard<mutex> lock(victim.lock);
+			if (!victim.tasks.empty() && (group == NULL || victim.tasks.front().group == group))
+			{
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			lock_guard<mutex> lock(injectedLock);
+			if (!injected.empty() && (group == NULL || injected.front().group == group))
+			{
+				task = injected.front();
+				injected.pop_front();
+				found = true;
+			}
+		}
+
+		if (found)
+		{
+			lock_guard<mutex> lock(sleepLock);
+			queued--;
+		}
+		return found;
+	}
+
+	void execute(poolTask& task)
+	{
+		task.run();
+		if (--task.group->pending == 0)
+		{
+			lock_guard<mutex> lock(doneLock);
+			done.notify_all();
+		}
+	}
+
+	void workerLoop(int self)
+	{
+		currentPool() = this;
+		currentWorker() = self;
+
+		for (;;)
+		{
+			poolTask task;
+			if (take(self, task, NULL))
+			{
+				execute(task);
+				continue;
+			}
+
+			unique_lock<mutex> lock(sleepLock);
+			wake.wait(lock, [this] { return stopping || queued > 0; });
+			if (stopping && queued == 0)
+				return;
+		}
+	}
+};
+
+//body(first, last) over [begin, end) in chunks of at least grain items,
+//spread over pool; runs inline when there is no pool or only one chunk.
+inline void parallelFor(workStealingPool* pool, int begin, int end, int grain, const function<void(int, int)>& body)
+{
+	if (grain < 1)
+		grain = 1;
+	if (pool == NULL || pool->size() < 2 || end - begin <= grain)
+	{
+		if (begin < end)
+			body(begin, end);
+		return;
+	}
+
+	int chunks = (end - begin + grain - 1) / grain;
+	if (chunks > 4 * pool->size())
+		chunks = 4 * pool->size(); //a few per worker is enough to balance
+	int step = (end - begin + chunks - 1) / chunks;
+
+	taskGroup group;
+	for (int first = begin; first < end; first += step)
+	{
+		int last = first + step < end ? first + step : end;
+		pool->submit(group, [&body, first, last] { body(first, last); });
+	}
+	pool->wait(group);
+}
+
+//Runs first and second, side by side when the pool has more than one
+//thread: second goes to the pool, first runs on the caller, and both are
+//done on return.
+inline void parallelInvoke(workStealingPool* pool, const function<void()>& first, const function<void()>& second)
+{
+	if (pool == NULL || pool->size() < 2)
+	{
+		first();
+		second();
+		return;
+	}
+
+	taskGroup group;
+	pool->submit(group, [&second] { second(); });
+	first();
+	pool->wait(group);
+}
+
+#endif
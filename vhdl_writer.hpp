@@ -0,0 +1,325 @@
+#ifndef VHDL_WRITER_HPP
+#define VHDL_WRITER_HPP
+
+#include "multiplexor.hpp"
+#include <charconv>
+#include <string_view>
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Netlist emitter. The whole VHDL text is formatted into one string that is
+//reserved up front from the netlist counts, with integers formatted by
+//to_chars rather than through a locale-aware stream, and reaches the disk
+//with a single write(). Callers that only post-process the VHDL can call
+//emitVHDL() and never touch a file.
+
+//appends to a string; just the << forms the emitter uses
+struct vhdlBuffer {
+	string& text;
+
+	vhdlBuffer(string& sink) : text(sink) {}
+
+	vhdlBuffer& operator<<(string_view s)
+	{
+		text.append(s.data(), s.size());
+		return *this;
+	}
+
+	vhdlBuffer& operator<<(char c)
+	{
+		text.push_back(c);
+		return *this;
+	}
+
+	vhdlBuffer& operator<<(long long n)
+	{
+		char digits[24];
+		to_chars_result r = to_chars(digits, digits + sizeof(digits), n);
+		text.append(digits, r.ptr - digits);
+		return *this;
+	}
+
+	vhdlBuffer& operator<<(int n) { return *this << (long long)n; }
+	vhdlBuffer& operator<<(size_t n) { return *this << (long long)n; }
+};
+
+//upper bound of the text's size, from the lengths of the fixed parts and a
+//generous allowance for every port, instance and mux input
+size_t estimateVHDLSize(synthesisContext& ctx)
+{
+	size_t bytes = 4096; //library clause, entity header, component declarations
+	size_t muxInputs = 0;
+
+	for (int i = 0; i < ctx.inputs.size(); i++)
+		bytes += 2 * ctx.symbols[ctx.inputs[i]].name.size() + 96;
+	for (int i = 0; i < ctx.outputs.size(); i++)
+		bytes += 2 * ctx.symbols[ctx.outputs[i]].name.size() + 128;
+	for (int i = 0; i < ctx.muxResources.size(); i++)
+		muxInputs += ctx.muxResources[i].numInputs;
+
+	bytes += ctx.regResources.size() * 256; //signal and C_Register instance
+	bytes += ctx.opResources.size() * 320; //signal and unit instance
+	bytes += ctx.muxResources.size() * 192 + muxInputs * 64;
+	return bytes;
+}
+
+//FU<component>_<n> of a functional unit: the component number of its type
+//and its ordinal among the units of that type
+void writeUnitName(vhdlBuffer& out, synthesisContext& ctx, int unit)
+{
+	const string& type = ctx.opResources[unit].type;
+
+	if (type == "MULT")
+		out << "FU" << 0 << "_" << ctx.binding.unitOrdinal[unit];
+	else if (type == "SUB")
+		out << "FU" << 1 << "_" << ctx.binding.unitOrdinal[unit];
+	else if (type == "ADD")
+		out << "FU" << 2 << "_" << ctx.binding.unitOrdinal[unit];
+}
+
+//R<n>_out of the register clique that holds a signal, or the signal itself
+//if it was never given a register
+void writeRegisterOutput(vhdlBuffer& out, synthesisContext& ctx, int symbolId)
+{
+	int regIndex = ctx.symbols[symbolId].reg;
+
+	if (regIndex == -1)
+		out << ctx.symbols[symbolId].name;
+	else
+		out << "R" << ctx.binding.regClique[regIndex] << "_out";
+}
+
+//The whole netlist, appended to text (an in-memory sink; writeVHDL() puts
+//it on disk).
+void emitVHDL(synthesisContext& ctx, string& text)
+{
+	int controlBits = 0, muxSelBits, muxNumInputs, muxMaxInputs;
+	int controlBitIndex = 0;
+	int resIndex, regIndex, regSymbol, opIndex, muxIndex;
+	bindingIndex& binding = ctx.binding;
+	vhdlBuffer out(text);
+
+	text.reserve(text.size() + estimateVHDLSize(ctx));
+
+	out << "library IEEE;\n";
+	out << "use IEEE.std_logic_1164.all;\n\n";
+
+	out << "entity input_dp is\n";
+	out << "port(\t";
+	for (int i = 0; i < ctx.inputs.size(); i++)
+		out << ctx.symbols[ctx.inputs[i]].name << " : IN std_logic_vector(" << ctx.inputBits - 1 << " downto 0);\n\t";
+
+	for (int i = 0; i < ctx.outputs.size(); i++)
+		out << ctx.symbols[ctx.outputs[i]].name << " : OUT std_logic_vector(" << ctx.outputBits - 1 << " downto 0);\n\t";
+
+	out << "ctrl: IN std_logic_vector(";
+
+	controlBits += ctx.regResources.size();
+	for (int i = 0; i < ctx.muxResources.size(); i++)
+	{
+		muxSelBits = 0;
+		muxMaxInputs = 1;
+		do
+		{
+			muxNumInputs = ctx.muxResources[i].numInputs;
+			muxSelBits++;
+			muxMaxInputs *= 2;
+		} while (muxNumInputs > muxMaxInputs);
+		controlBits += muxSelBits;
+	}
+	controlBits--;
+	out << controlBits << " downto 0);\n\t clear: IN std_logic;\n\tclock: IN std_logic\n);\nend input_dp;\n";
+
+	out << "\narchitecture RTL of input_dp is\n\n";
+
+	out << "  component c_register\n";
+	out << "  generic (width : integer := 4);\n";
+	out << "  port (input : in std_logic_vector((width-1) downto 0);\n";
+	out << "    WR: in std_logic;\n";
+	out << "    clear : in std_logic;\n";
+	out << "    clock : in std_logic;\n";
+	out << "    output : out std_logic_vector((width -1) downto 0));\n";
+	out << "  end component;\n\n";
+
+	out << "  component C_Adder\n";
+	out << "    generic (width : integer); \n";
+	out << "    port(  input1 : in Std_logic_vector ((width - 1) downto 0); \n";
+	out << "    input2 : in Std_logic_vector ((width - 1) downto 0); \n";
+	out << "    output : out Std_logic_vector (width downto 0)); \n";
+	out << "  end component;\n\n";
+
+	out << "  component C_subtractor\n";
+	out << "    generic (width : integer); \n";
+	out << "    port(  input1 : in Std_logic_vector ((width - 1) downto 0); \n";
+	out << "    input2 : in Std_logic_vector ((width - 1) downto 0); \n";
+	out << "    output : out Std_logic_vector (width downto 0)); \n";
+	out << "  end component; \n\n";
+
+	out << "  component C_multiplier \n";
+	out << "    generic (width : integer); \n";
+	out << "    port(  input1 : in Std_logic_vector ((width - 1) downto 0); \n";
+	out << "    input2 : in Std_logic_vector ((width - 1) downto 0); \n";
+	out << "    output : out Std_logic_vector (((width * 2) - 2) downto 0)); \n";
+	out << "  end component; \n\n";
+
+	out << "  component C_Multiplexer\n";
+	out << "    generic (width : integer;\n";
+	out << "      no_of_inputs : integer;\n";
+	out << "      select_size : integer); \n";
+	out << "    port(  input : in Std_logic_vector (((width*no_of_inputs) - 1) downto 0);\n";
+	out << "    MUX_SELECT : in Std_logic_vector ((select_size - 1) downto 0);\n";
+	out << "    output : out Std_logic_vector ((width - 1) downto 0)); \n";
+	out << "  end component; \n\n";
+
+	for (int i = 0; i < ctx.regResources.size(); i++)
+		out << "\tsignal R" << i << "_out : Std_logic_vector(" << ctx.registerBits - 1 << " downto 0);\n";
+
+	out << "\n";
+
+	for (int i = 0; i < ctx.opResources.size(); i++)
+	{
+		out << "\tsignal ";
+		writeUnitName(out, ctx, i);
+		out << "_out : Std_logic_vector(" << ctx.operationBits << " downto 0);\n";//ask Richard about FU signal length
+	}
+	out << "\n";
+	for (int i = 0; i < ctx.muxResources.size(); i++)
+		out << "\tsignal Mux" << i << "_out :  Std_logic_vector(" << ctx.inputBits << " downto 0);\n";
+
+	out << "\nbegin\n\n";
+
+	for (int i = 0; i < ctx.regResources.size(); i++)
+	{
+
+		out << "\tR" << i << "  : C_Register\n\t generic map(" << ctx.registerBits << ")\n";
+		out << "\t port map (\n\t\t input(" << ctx.registerBits - 1 << " downto 0) => ";
+		muxIndex = binding.regMux[i];
+		if (muxIndex != -1)
+			out << "Mux" << muxIndex << "_out(" << ctx.inputBits - 1 << " downto 0),\n";
+		else {
+
+			out << ctx.symbols[ctx.registers[ctx.regResources[i][0]].symbolId].name << "(" << ctx.inputBits - 1 << " downto 0),\n";
+		}
+		out << "\t\t WR => ctrl(" << i << "),\n\t\t CLEAR => clear,\n";
+		out << "\t\t CLOCK => clock,\n\t\t output => R" << i << "_out);\n\n";
+	}
+
+	for (int i = 0; i < ctx.opResources.size(); i++)
+	{
+		out << "\t" << ctx.opResources[i].type;
+		if (ctx.opResources[i].type == "MULT")
+			out << 0 << "_" << binding.unitOrdinal[i] << " : C_Multiplier\n";
+		else if (ctx.opResources[i].type == "SUB")
+			out << 1 << "_" << binding.unitOrdinal[i] << " : C_Subtractor\n";
+		else if (ctx.opResources[i].type == "ADD")
+			out << 2 << "_" << binding.unitOrdinal[i] << " : C_Adder\n";
+		out << "\t\t generic map(" << ctx.operationBits << ")\n";
+		out << "\t\t port map (\n";
+		out << "\t\t input1(" << ctx.operationBits - 1 << " downto 0) => ";
+		writeRegisterOutput(out, ctx, ctx.operations[ctx.opResources[i].clique[0]].operand1);
+		out << "(" << ctx.operationBits - 1 << " downto 0),\n";
+
+		out << "\t\t input2(" << ctx.operationBits - 1 << " downto 0) => ";
+		writeRegisterOutput(out, ctx, ctx.operations[ctx.opResources[i].clique[0]].operand2);
+		out << "(" << ctx.operationBits - 1 << " downto 0),\n";
+
+		out << "\t\t output(" << ctx.operationBits << " downto 0) => ";
+		writeUnitName(out, ctx, i);
+		out << "_out(" << ctx.operationBits << " downto 0));\n\n";
+	}
+
+	controlBitIndex = ctx.regResources.size();
+	for (int i = 0; i < ctx.muxResources.size(); i++)
+	{
+		out << "\tMUX" << i << " : C_Multiplexer\n";
+		out << "\t\tgeneric map(" << ctx.inputBits << ", ";
+		out << ctx.muxResources[i].numInputs << ", ";
+
+		muxSelBits = 0;
+		muxMaxInputs = 1;
+		do
+		{
+			muxNumInputs = ctx.muxResources[i].numInputs;
+			muxSelBits++;
+			muxMaxInputs *= 2;
+		} while (muxNumInputs > muxMaxInputs);
+
+		out << muxSelBits << ")\n";
+		out << "\t\tport map(\n";
+
+		for (int j = 0; j < muxNumInputs; j++)
+		{
+			out << "\t\tinput(" << ((j + 1)*ctx.operationBits) - 1 << " downto " << j*ctx.operationBits << ") => ";
+			resIndex = ctx.muxResources[i].resourceIndex;
+			if (ctx.muxResources[i].resourceBoundTo == "REG")
+			{
+				regIndex = ctx.regResources[resIndex][j]; //input j loads the j-th register of the clique
+				regSymbol = ctx.registers[regIndex].symbolId;
+				opIndex = ctx.symbols[regSymbol].producer;
+				if (ctx.symbols[regSymbol].isInput)
+					out << ctx.symbols[regSymbol].name;
+				else if (opIndex != -1) //from the unit its producer is bound to
+				{
+					writeUnitName(out, ctx, binding.opUnit[opIndex]);
+					out << "_out";
+				}
+				else //never written: the register keeps its value
+					out << "R" << resIndex << "_out";
+			}
+			else //is a function unit, sub/add/mult: input j is the register its j-th op writes
+				writeRegisterOutput(out, ctx, ctx.operations[ctx.opResources[resIndex].clique[j]].output);
+			out << "(" << ctx.operationBits - 1 << " downto 0),\n";
+		}
+
+		out << "\t\tMUX_SELECT(" << muxSelBits - 1 << " downto 0) => ctrl(";
+		out << controlBitIndex + (muxSelBits - 1) << " downto " << controlBitIndex << "),\n";
+		controlBitIndex += muxSelBits;
+		out << "\t\toutput => Mux" << i << "_out);\n";
+		out << "\n";
+	}
+
+	for (int i = 0; i < ctx.outputs.size(); i++)
+	{
+		out << "\t " << ctx.symbols[ctx.outputs[i]].name << "(" << ctx.outputBits - 1 << " downto 0) <= ";
+		writeRegisterOutput(out, ctx, ctx.outputs[i]);
+		out << "(" << ctx.outputBits - 1 << " downto 0);\n";
+	}
+	out << "end RTL;\n";
+}
+
+//text as the whole contents of path, with one write() where the OS allows
+bool writeTextFile(const string& path, const string& text)
+{
+#if defined(_WIN32)
+	ofstream out(path.c_str(), ios::binary);
+	out.write(text.data(), text.size());
+	return (bool)out;
+#else
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	const char* p = text.data();
+	size_t left = text.size();
+
+	if (fd < 0)
+		return false;
+	while (left > 0) //a regular file takes it all at once; loop for short writes
+	{
+		ssize_t n = write(fd, p, left);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+		{
+			close(fd);
+			return false;
+		}
+		p += n;
+		left -= n;
+	}
+	return close(fd) == 0;
+#endif
+}
+
+#endif